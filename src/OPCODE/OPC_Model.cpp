@@ -209,6 +209,39 @@ bool Model::Build(const OPCODECREATE& create)
 	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Restores a no-leaf collision model from nodes saved with AABBNoLeafTree::Save().
+ *	\param		imesh		[in] mesh interface the tree was built from
+ *	\param		nb_nodes	[in] number of saved nodes
+ *	\param		nodes		[in] saved nodes
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Model::Load(const MeshInterface* imesh, udword nb_nodes, const AABBNoLeafNode* nodes)
+{
+	if(!imesh || !imesh->IsValid())	return false;
+
+	Release();
+
+	SetMeshInterface(imesh);
+
+	// Same special case as Build()
+	udword NbTris = imesh->GetNbTriangles();
+	if(NbTris==1)
+	{
+		mModelCode |= OPC_SINGLE_NODE;
+		return nb_nodes==0;
+	}
+
+	// A complete no-leaf tree has one node less than there are triangles
+	if(nb_nodes!=NbTris-1)	return false;
+
+	if(!CreateTree(true, false))	return false;
+
+	return static_cast<AABBNoLeafTree*>(mTree)->Load(nb_nodes, nodes);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Gets the number of bytes used by the tree.
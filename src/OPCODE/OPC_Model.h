@@ -36,6 +36,17 @@
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		override(BaseModel)	bool				Build(const OPCODECREATE& create);
 
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Restores a no-leaf collision model from nodes saved with AABBNoLeafTree::Save().
+		 *	\param		imesh		[in] mesh interface the tree was built from
+		 *	\param		nb_nodes	[in] number of saved nodes
+		 *	\param		nodes		[in] saved nodes
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+							bool				Load(const MeshInterface* imesh, udword nb_nodes, const AABBNoLeafNode* nodes);
+
 #ifdef __MESHMERIZER_H__
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		/**
@@ -458,6 +458,62 @@ bool AABBNoLeafTree::Walk(GenericWalkingCallback callback, void* user_data) cons
 	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Copies the tree into a flat array, replacing child pointers with node indices so it can be stored on disk.
+ *	\param		nodes		[out] destination array of mNbNodes nodes
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void AABBNoLeafTree::Save(AABBNoLeafNode* nodes) const
+{
+	for(udword i=0;i<mNbNodes;i++)
+	{
+		nodes[i] = mNodes[i];
+		if(!mNodes[i].HasPosLeaf())	nodes[i].mPosData = size_t(mNodes[i].GetPos() - mNodes)<<1;
+		if(!mNodes[i].HasNegLeaf())	nodes[i].mNegData = size_t(mNodes[i].GetNeg() - mNodes)<<1;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Rebuilds the tree from an array written by Save().
+ *	\param		nb_nodes	[in] number of nodes
+ *	\param		nodes		[in] saved nodes
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBNoLeafTree::Load(udword nb_nodes, const AABBNoLeafNode* nodes)
+{
+	if(!nb_nodes || !nodes)	return false;
+
+	if(mNbNodes!=nb_nodes)
+	{
+		mNbNodes = nb_nodes;
+		DELETEARRAY(mNodes);
+		mNodes = new AABBNoLeafNode[nb_nodes];
+		CHECKALLOC(mNodes);
+	}
+
+	// Children always come after their parent, anything else is a corrupt array
+	for(udword i=0;i<nb_nodes;i++)
+	{
+		mNodes[i] = nodes[i];
+		if(!nodes[i].HasPosLeaf())
+		{
+			size_t Index = nodes[i].mPosData>>1;
+			if(Index<=i || Index>=nb_nodes)	return false;
+			mNodes[i].mPosData = size_t(&mNodes[Index]);
+		}
+		if(!nodes[i].HasNegLeaf())
+		{
+			size_t Index = nodes[i].mNegData>>1;
+			if(Index<=i || Index>=nb_nodes)	return false;
+			mNodes[i].mNegData = size_t(&mNodes[Index]);
+		}
+	}
+	return true;
+}
+
 // Quantization notes:
 // - We could use the highest bits of mData to store some more quantized bits. Dequantization code
 //   would be slightly more complex, but number of overlap tests would be reduced (and anyhow those
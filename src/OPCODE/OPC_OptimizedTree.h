@@ -183,6 +183,11 @@
 	class OPCODE_API AABBNoLeafTree : public AABBOptimizedTree
 	{
 		IMPLEMENT_COLLISION_TREE(AABBNoLeafTree, AABBNoLeafNode)
+
+		public:
+		// Serialization, child links are stored as node indices
+									void			Save(AABBNoLeafNode* nodes)						const;
+									bool			Load(udword nb_nodes, const AABBNoLeafNode* nodes);
 	};
 
 	class OPCODE_API AABBQuantizedTree : public AABBOptimizedTree
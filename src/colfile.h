@@ -0,0 +1,52 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <cstdint>
+
+// Constants
+const uint32_t COLFILE_MAGIC = 0x4c4f4349;
+const uint32_t COLFILE_VERSION = 2;
+const uint32_t COLFILE_ALIGNMENT = 16;
+const uint32_t COLFILE_INDEX_SIZE = 4;
+
+// Header of a version 2 collision mesh.
+// Version 1 files have no header and start with int vertex and face counts, followed by
+// vertices in Irrlicht coordinates and faces in Irrlicht winding.
+// Version 2 blocks start at 16 byte aligned offsets and are stored the way ODE uses them:
+// float vertices with z negated, faces with reversed winding and 16 or 32 bit indices, and
+// optionally one float face normal per face. Indices that don't match ODE's dTriIndex are
+// copied at load, so colmesh writes COLFILE_INDEX_SIZE indices unless asked otherwise.
+struct _ColHeader {
+
+	enum FlagType {
+		FLAG_NORMALS = 1,
+	};
+
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t VertexCount;
+	uint32_t FaceCount;
+	uint32_t IndexSize;
+	uint32_t Flags;
+	uint32_t VertexOffset;
+	uint32_t IndexOffset;
+	uint32_t NormalOffset;
+	uint32_t Reserved[3];
+};
@@ -60,6 +60,9 @@ void _Config::Reset() {
 	ShowFPS = false;
 	ShowTutorial = true;
 
+	// Physics
+	PhysicsThreads = 0;
+
 	// Audio
 	SoundVolume = 1.0;
 	PlayerSounds = true;
@@ -260,6 +263,12 @@ int _Config::ReadConfig() {
 		GameplayElement->QueryBoolAttribute("showtutorial", &ShowTutorial);
 	}
 
+	// Check for the physics tag
+	XMLElement *PhysicsElement = ConfigElement->FirstChildElement("physics");
+	if(PhysicsElement) {
+		PhysicsElement->QueryIntAttribute("threads", &PhysicsThreads);
+	}
+
 	// Check for the audio tag
 	XMLElement *AudioElement = ConfigElement->FirstChildElement("audio");
 	if(AudioElement) {
@@ -350,6 +359,11 @@ int _Config::WriteConfig() {
 	GameplayElement->SetAttribute("showtutorial", ShowTutorial);
 	ConfigElement->LinkEndChild(GameplayElement);
 
+	// Create physics element
+	XMLElement *PhysicsElement = Document.NewElement("physics");
+	PhysicsElement->SetAttribute("threads", PhysicsThreads);
+	ConfigElement->LinkEndChild(PhysicsElement);
+
 	// Create audio element
 	XMLElement *AudioElement = Document.NewElement("audio");
 	AudioElement->SetAttribute("sound_volume", SoundVolume);
@@ -51,6 +51,9 @@ class _Config {
 		int AnisotropicFiltering;
 		int AntiAliasing;
 
+		// Physics
+		int PhysicsThreads;
+
 		// Audio
 		float SoundVolume;
 		bool PlayerSounds;
@@ -173,9 +173,14 @@ void SGUITTGlyph::preload(u32 char_index, FT_Face face, video::IVideoDriver* dri
 
 	glyph_page = parent->getLastGlyphPageIndex();
 	u32 texture_side_length = page->texture->getOriginalSize().Width;
+
+	// The null driver creates textures with no size.
+	u32 glyphs_per_row = texture_side_length / font_size;
+	if (glyphs_per_row == 0)
+		glyphs_per_row = 1;
 	core::vector2di page_position(
-		(page->used_slots % (texture_side_length / font_size)) * font_size,
-		(page->used_slots / (texture_side_length / font_size)) * font_size
+		(page->used_slots % glyphs_per_row) * font_size,
+		(page->used_slots / glyphs_per_row) * font_size
 		);
 	source_rect.UpperLeftCorner = page_position;
 	source_rect.LowerRightCorner = core::vector2di(page_position.X + bits.width, page_position.Y + bits.rows);
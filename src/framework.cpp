@@ -29,17 +29,52 @@
 #include <objectmanager.h>
 #include <config.h>
 #include <save.h>
+#include <profiler.h>
 #include <campaign.h>
+#include <replay.h>
+#include <validator.h>
 #include <states/play.h>
 #include <states/viewreplay.h>
 #include <states/null.h>
 #include <menu.h>
+#include <objects/object.h>
+#include <objects/player.h>
+#include <actions.h>
+#include <camera.h>
+#include <ode/objects.h>
 #include <IFileSystem.h>
 #include <iostream>
 #include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <random>
+#include <unordered_map>
+
+#ifdef _WIN32
+	#include <process.h>
+	#define getpid _getpid
+#else
+	#include <unistd.h>
+#endif
 
 using namespace irr;
 
+// Object orientation and player input after one step of the replay test
+struct _ReplayTestSample {
+	uint16_t ObjectID;
+	glm::vec3 Position;
+	glm::quat Rotation;
+};
+
+struct _ReplayTestStep {
+	std::vector<_ReplayTestSample> Objects;
+	_ReplayInputData Input;
+	bool HasPacket;
+	_ReplayInputData Packet;
+};
+
 _Framework Framework;
 
 // Processes parameters and initializes the game
@@ -52,9 +87,19 @@ int _Framework::Init(int Count, char **Arguments) {
 	WindowActive = true;
 	MouseWasLocked = false;
 	Done = false;
+	ExitCode = 0;
+	Simulating = false;
+	SnapshotTesting = false;
+	ReplayTesting = false;
+	SimulateSteps = 0;
+	ValidateJobs = 0;
+	ValidatePath = "";
+	Executable = Arguments[0];
 	_State *FirstState = &NullState;
 	video::E_DRIVER_TYPE DriverType = video::EDT_NULL;
 	bool AudioEnabled = true;
+	bool SimulateReplay = false;
+	std::string ReplayFile;
 	PlayState.SetCampaign(-1);
 	PlayState.SetCampaignLevel(-1);
 
@@ -85,8 +130,7 @@ int _Framework::Init(int Count, char **Arguments) {
 			FirstState = &PlayState;
 		}
 		else if(Token == "-replay" && TokensRemaining > 0) {
-			ViewReplayState.SetCurrentReplay(Arguments[++i]);
-			FirstState = &ViewReplayState;
+			ReplayFile = Arguments[++i];
 		}
 		else if(Token == "-noaudio") {
 			AudioEnabled = false;
@@ -95,6 +139,34 @@ int _Framework::Init(int Count, char **Arguments) {
 			PlayState.SetValidateReplay(Arguments[++i]);
 			FirstState = &PlayState;
 		}
+		else if(Token == "-simulate" && TokensRemaining > 0) {
+			PlayState.SetTestLevel(Arguments[++i]);
+			FirstState = &PlayState;
+			Simulating = true;
+		}
+		else if(Token == "-snapshot-test" && TokensRemaining > 0) {
+			PlayState.SetTestLevel(Arguments[++i]);
+			FirstState = &PlayState;
+			Simulating = true;
+			SnapshotTesting = true;
+		}
+		else if(Token == "-replay-test" && TokensRemaining > 0) {
+			PlayState.SetTestLevel(Arguments[++i]);
+			FirstState = &PlayState;
+			Simulating = true;
+			ReplayTesting = true;
+		}
+		else if(Token == "-steps" && TokensRemaining > 0) {
+			SimulateSteps = atoi(Arguments[++i]);
+		}
+		else if(Token == "-validate-dir" && TokensRemaining > 0) {
+			ValidatePath = Arguments[++i];
+			Simulating = true;
+			SimulateReplay = true;
+		}
+		else if(Token == "-jobs" && TokensRemaining > 0) {
+			ValidateJobs = atoi(Arguments[++i]);
+		}
 		else if(Token == "-resolution" && TokensRemaining > 1) {
 			std::stringstream Buffer(std::string(Arguments[i+1]) + " " + std::string(Arguments[i+2]));
 			Buffer >> Config.ScreenWidth >> Config.ScreenHeight;
@@ -108,9 +180,32 @@ int _Framework::Init(int Count, char **Arguments) {
 		}
 	}
 
+	// Replays are validated when simulating and viewed otherwise, regardless of argument order
+	if(ReplayFile != "") {
+		if(Simulating) {
+			PlayState.SetValidateReplay(ReplayFile);
+			SimulateReplay = true;
+		}
+		else {
+			ViewReplayState.SetCurrentReplay(ReplayFile);
+			FirstState = &ViewReplayState;
+		}
+	}
+
+	// Simulations run without a window or sound
+	if(Simulating) {
+		AudioEnabled = false;
+
+		// Stop simulations that have no replay to end them
+		if(SimulateSteps <= 0 && !SimulateReplay)
+			SimulateSteps = SIMULATE_DEFAULT_STEPS;
+	}
+
 	// Set up the graphics
 	DriverType = (video::E_DRIVER_TYPE)Config.DriverType;
-	if(!Graphics.Init(!HasConfigFile, Config.ScreenWidth, Config.ScreenHeight, Config.Fullscreen, DriverType, &Input))
+	if(Simulating)
+		DriverType = video::EDT_NULL;
+	if(!Graphics.Init(!HasConfigFile && !Simulating, Config.ScreenWidth, Config.ScreenHeight, Config.Fullscreen, DriverType, &Input))
 		return 0;
 
 	// Initialize joystick
@@ -135,7 +230,7 @@ int _Framework::Init(int Count, char **Arguments) {
 	WorkingPath = std::string(irrFile->getWorkingDirectory().c_str()) + "/";
 
 	// Write a config file if none exists
-	if(!HasConfigFile)
+	if(!HasConfigFile && !Simulating)
 		Config.WriteConfig();
 
 	// Initialize level stats
@@ -164,6 +259,10 @@ int _Framework::Init(int Count, char **Arguments) {
 	if(!Campaign.Init())
 		return 0;
 
+	// Start the replay writer
+	if(!Replay.Init())
+		return 0;
+
 	// Set up fader
 	if(!Fader.Init())
 		return 0;
@@ -195,6 +294,21 @@ void _Framework::ChangeState(_State *State) {
 // Updates the current state and runs the game engine
 void _Framework::Update() {
 
+	// Run headless simulation
+	if(Simulating) {
+		if(ValidatePath != "") {
+			Done = true;
+			ExitCode = Validator.Run(Executable, ValidatePath, ValidateJobs) ? 0 : 1;
+		}
+		else if(SnapshotTesting)
+			TestSnapshot();
+		else if(ReplayTesting)
+			TestReplay();
+		else
+			Simulate();
+		return;
+	}
+
 	// Run irrlicht engine
 	if(!irrDevice->run())
 		Done = true;
@@ -242,6 +356,7 @@ void _Framework::Update() {
 			TimeStepAccumulator += LastFrameTime.count() * TimeScale;
 			while(TimeStepAccumulator >= TimeStep) {
 				State->Update(TimeStep);
+				Profiler.AddStep();
 				TimeStepAccumulator -= TimeStep;
 			}
 
@@ -256,9 +371,19 @@ void _Framework::Update() {
 		break;
 	}
 
-	Audio.Update();
-	State->Draw();
+	// Update audio
+	{
+		_ProfilerScope Scope(_Profiler::SECTION_AUDIO);
+		Audio.Update();
+	}
+
+	// Draw interface
+	{
+		_ProfilerScope Scope(_Profiler::SECTION_GUI);
+		State->Draw();
+	}
 	Graphics.EndFrame();
+	Profiler.EndFrame(LastFrameTime.count());
 
 	// Limit frame rate
 	if(Config.MaxFPS > 0) {
@@ -278,6 +403,7 @@ void _Framework::Close() {
 	State->Close();
 
 	// Shut down the system
+	Replay.Close();
 	DisableAudio();
 	Campaign.Close();
 	Fader.Close();
@@ -297,6 +423,359 @@ void _Framework::ResetTimer() {
 	FrameLimitTimestamp = std::chrono::high_resolution_clock::now();
 }
 
+// Runs the play state as fast as possible without rendering
+void _Framework::Simulate() {
+	Done = true;
+
+	// Initialize the state
+	Input.ResetInputState();
+	if(!State->Init())
+		return;
+
+	// Step until the level ends or the step limit is reached
+	int Steps = 0;
+	auto StartTime = std::chrono::high_resolution_clock::now();
+	while(!PlayState.IsPaused() && (SimulateSteps <= 0 || Steps < SimulateSteps)) {
+		State->Update(TimeStep);
+		Profiler.AddStep();
+		Profiler.EndFrame(TimeStep);
+		Steps++;
+	}
+	std::chrono::duration<double> WallTime = std::chrono::high_resolution_clock::now() - StartTime;
+
+	// Get outcome
+	const char *Result = "stopped";
+	if(Menu.GetState() == _Menu::STATE_WIN)
+		Result = "won";
+	else if(Menu.GetState() == _Menu::STATE_LOSE)
+		Result = "lost";
+
+	// Report results
+	double StepsPerSecond = WallTime.count() > 0.0 ? Steps / WallTime.count() : 0.0;
+	Log.Write("Simulation %s after %d steps, game time=%fs wall time=%fs steps/sec=%.0f", Result, Steps, PlayState.GetTimer(), WallTime.count(), StepsPerSecond);
+
+	// Report average step timings
+	_Profiler::_Frame Average;
+	Profiler.GetAverage(Average, PROFILER_HISTORY);
+	for(int i = 0; i < _Profiler::SECTION_COUNT; i++)
+		Log.Write("%-10s %.4f ms/step", _Profiler::GetSectionName(i), Average.Times[i] * 1000.0);
+}
+
+// Steps a level, takes a snapshot, steps on, diverges, restores and checks that the steps after the snapshot repeat exactly
+void _Framework::TestSnapshot() {
+	Done = true;
+	ExitCode = 1;
+
+	// Initialize the state
+	Input.ResetInputState();
+	if(!State->Init())
+		return;
+
+	// Run the first half and take a snapshot
+	int Half = SimulateSteps / 2;
+	for(int i = 0; i < Half && !PlayState.IsPaused(); i++)
+		State->Update(TimeStep);
+
+	_PhysicsSnapshot Snapshot;
+	auto StartTime = std::chrono::high_resolution_clock::now();
+	Physics.Snapshot(Snapshot);
+	std::chrono::duration<double> SnapshotTime = std::chrono::high_resolution_clock::now() - StartTime;
+	float Timer = PlayState.GetTimer();
+	uint32_t SnapshotHash = ObjectManager.GetBodyStateHash();
+
+	// Record the hash after each step of the second half
+	std::vector<uint32_t> Hashes;
+	for(int i = 0; i < Half && !PlayState.IsPaused(); i++) {
+		State->Update(TimeStep);
+		Hashes.push_back(ObjectManager.GetBodyStateHash());
+	}
+	uint32_t EndHash = ObjectManager.GetBodyStateHash();
+
+	// Push every body and keep going so the world no longer matches
+	for(auto &Object : ObjectManager.GetObjects()) {
+		dBodyID Body = Object->GetBody();
+		if(!Body)
+			continue;
+
+		const dReal *Velocity = dBodyGetLinearVel(Body);
+		dBodyEnable(Body);
+		dBodySetLinearVel(Body, Velocity[0] + 1, Velocity[1] + 3, Velocity[2] - 2);
+	}
+	for(int i = 0; i < SNAPSHOT_TEST_DIVERGE_STEPS && !PlayState.IsPaused(); i++)
+		State->Update(TimeStep);
+	if(ObjectManager.GetBodyStateHash() == EndHash) {
+		Log.Write("Snapshot test failed, the world did not diverge");
+		return;
+	}
+
+	// Restore, resuming play if the level ended while diverging
+	StartTime = std::chrono::high_resolution_clock::now();
+	if(!Physics.Restore(Snapshot)) {
+		Log.Write("Snapshot test failed, unable to restore the snapshot");
+		return;
+	}
+	std::chrono::duration<double> RestoreTime = std::chrono::high_resolution_clock::now() - StartTime;
+	PlayState.SetTimer(Timer);
+	if(PlayState.IsPaused())
+		Menu.InitPlay();
+
+	if(ObjectManager.GetBodyStateHash() != SnapshotHash) {
+		Log.Write("Snapshot test failed, restored state does not match the snapshot");
+		return;
+	}
+
+	// Step the second half again
+	for(size_t i = 0; i < Hashes.size(); i++) {
+		if(PlayState.IsPaused()) {
+			Log.Write("Snapshot test failed, level ended early at step %d", (int)i + 1);
+			return;
+		}
+
+		State->Update(TimeStep);
+		if(ObjectManager.GetBodyStateHash() != Hashes[i]) {
+			Log.Write("Snapshot test failed, mismatch at step %d after the snapshot", (int)i + 1);
+			return;
+		}
+	}
+
+	ExitCode = 0;
+	Log.Write("Snapshot test passed after %d+%d steps, objects=%d size=%d snapshot=%.3fms restore=%.3fms", Half, (int)Hashes.size(), (int)ObjectManager.GetObjectCount(), (int)Snapshot.GetSize(), SnapshotTime.count() * 1000.0, RestoreTime.count() * 1000.0);
+}
+
+// Records a level with scripted input, then decodes the saved replay and checks it against the state after each step
+void _Framework::TestReplay() {
+	Done = true;
+	ExitCode = 1;
+
+	// Initialize the state
+	Input.ResetInputState();
+	if(!State->Init())
+		return;
+
+	_Player *Player = static_cast<_Player *>(ObjectManager.GetObjectByType(_Object::PLAYER));
+	_Camera *Camera = PlayState.GetCamera();
+	if(!Player)
+		return;
+
+	// Get keys for movement
+	const int MoveActions[] = { _Actions::MOVE_LEFT, _Actions::MOVE_RIGHT, _Actions::MOVE_FORWARD, _Actions::MOVE_BACK };
+	int MoveKeys[4];
+	for(int i = 0; i < 4; i++)
+		MoveKeys[i] = Actions.GetInputForAction(_Input::KEYBOARD, MoveActions[i]);
+
+	// Play with scripted input, saving what the replay should hold
+	std::minstd_rand Random(1);
+	std::vector<_ReplayTestStep> Steps;
+	std::unordered_map<float, size_t> StepTimes;
+	int Jumps = 0;
+	for(int i = 0; i < SimulateSteps && !PlayState.IsPaused(); i++) {
+
+		// Change keys and turn the camera now and then
+		if(i % REPLAY_TEST_INPUT_INTERVAL == 0) {
+			for(int j = 0; j < 4; j++) {
+				if(MoveKeys[j] >= 0)
+					Actions.InputEvent(_Input::KEYBOARD, MoveKeys[j], (float)(Random() % 2));
+			}
+			if(Random() % 2)
+				Camera->SetYaw(Camera->GetYaw() + (float)(Random() % 90) - 45.0f);
+		}
+
+		// Jump at random
+		bool Jumped = Random() % REPLAY_TEST_JUMP_CHANCE == 0;
+		if(Jumped) {
+			PlayState.HandleAction(_Input::KEYBOARD, _Actions::JUMP, 1.0f);
+			Jumps++;
+		}
+
+		State->Update(TimeStep);
+
+		// Input as RecordInput saw it
+		_ReplayTestStep Step;
+		core::vector3df Push(0.0f, 0.0f, 0.0f);
+		Player->GetPushDirection(Push);
+		Step.Input.PushX = Push.X;
+		Step.Input.PushZ = Push.Z;
+		Step.Input.Yaw = Camera->GetYaw();
+		Step.Input.Pitch = Camera->GetPitch();
+		Step.Input.Jumped = Jumped;
+		Step.HasPacket = false;
+
+		// Only bodies get movement packets
+		for(auto &Object : ObjectManager.GetObjects()) {
+			if(!Object->GetBody())
+				continue;
+
+			_ReplayTestSample Sample;
+			Sample.ObjectID = Object->GetID();
+			Sample.Position = Object->GetPosition();
+			Sample.Rotation = Object->GetQuaternion();
+			Step.Objects.push_back(Sample);
+		}
+
+		// Events are stamped with the same time as the play state timer
+		StepTimes[PlayState.GetTimer()] = Steps.size();
+		Steps.push_back(Step);
+	}
+	Actions.ResetState();
+
+	// Save the replay outside the replay folder, then wait for the writer thread to finish
+	std::string Path = Save.TempPath + "irrlamb-replaytest-" + std::to_string(getpid()) + ".replay";
+	size_t RawSize = Replay.GetWriter().GetOffset();
+	Replay.SaveReplay("Replay test", false, false, Path);
+	Replay.StopRecording();
+	Replay.GetWriter().Wait();
+
+	// Load it back
+	_Replay SavedReplay;
+	if(!SavedReplay.LoadReplay(Path)) {
+		Log.Write("Replay test failed, unable to load %s", Path.c_str());
+		remove(Path.c_str());
+		return;
+	}
+	size_t FileSize = SavedReplay.GetReader().GetMappingSize();
+
+	// Quantization bounds, the largest quaternion component is rebuilt from the other three
+	const float RotationBound = 0.5f / REPLAY_ROTATION_SCALE + 1e-6f;
+	const float LargestRotationBound = 3.0f * RotationBound;
+
+	// Decode every event
+	_ReplayReader &Reader = SavedReplay.GetReader();
+	std::unordered_map<uint16_t, _ReplayOrientation> Bases;
+	int Samples = 0;
+	int Failures = 0;
+	float MaxPositionError = 0.0f;
+	float MaxRotationError = 0.0f;
+	_ReplayEvent Event;
+	SavedReplay.ReadEvent(Event);
+	while(!SavedReplay.ReplayStopped()) {
+		auto StepIterator = StepTimes.find(Event.Timestamp);
+		_ReplayTestStep *Step = StepIterator != StepTimes.end() ? &Steps[StepIterator->second] : nullptr;
+
+		switch(Event.Type) {
+			case _Replay::PACKET_MOVEMENT: {
+				int16_t ObjectCount = Reader.Get<int16_t>();
+				size_t Cursor = 0;
+				for(int i = 0; i < ObjectCount; i++) {
+					uint16_t ObjectID = Reader.Get<uint16_t>();
+					_ReplayOrientation &Base = Bases[ObjectID];
+					Reader.GetMovement(Base);
+					Samples++;
+
+					// Find the object, samples are written in object order
+					const _ReplayTestSample *Sample = nullptr;
+					for(size_t j = 0; Step && j < Step->Objects.size(); j++) {
+						size_t Index = (Cursor + j) % Step->Objects.size();
+						if(Step->Objects[Index].ObjectID == ObjectID) {
+							Sample = &Step->Objects[Index];
+							Cursor = Index + 1;
+							break;
+						}
+					}
+					if(!Sample) {
+						Log.Write("Replay test failed, movement for unknown object %d at %fs", ObjectID, Event.Timestamp);
+						Failures++;
+						continue;
+					}
+
+					// Compare position
+					glm::vec3 Position;
+					glm::quat Rotation;
+					Base.Get(Position, Rotation);
+					bool Passed = true;
+					for(int j = 0; j < 3; j++) {
+						float Error = std::abs(Position[j] - Sample->Position[j]);
+						float Bound = 0.5f / REPLAY_POSITION_SCALE + std::abs(Sample->Position[j]) * 2.0f * FLT_EPSILON;
+						MaxPositionError = std::max(MaxPositionError, Error);
+						if(Error > Bound)
+							Passed = false;
+					}
+
+					// Compare rotation, q and -q are the same rotation
+					glm::quat Expected = Sample->Rotation;
+					if(glm::dot(Expected, Rotation) < 0.0f)
+						Expected = -Expected;
+					float Components[4] = { Expected.x, Expected.y, Expected.z, Expected.w };
+					float Decoded[4] = { Rotation.x, Rotation.y, Rotation.z, Rotation.w };
+					for(int j = 0; j < 4; j++) {
+						float Error = std::abs(Components[j] - Decoded[j]);
+						MaxRotationError = std::max(MaxRotationError, Error);
+						if(Error > (j == Base.RotationIndex ? LargestRotationBound : RotationBound))
+							Passed = false;
+					}
+
+					if(!Passed) {
+						Log.Write("Replay test failed, object %d at %fs is outside the quantization bounds", ObjectID, Event.Timestamp);
+						Failures++;
+					}
+				}
+			} break;
+			case _Replay::PACKET_DELETE:
+
+				// Ids are only reused after a delete, so a new object starts without a base
+				Bases.erase((uint16_t)Reader.View<_ReplayDeleteData>()->ObjectID);
+			break;
+			case _Replay::PACKET_INPUT: {
+				const _ReplayInputData *Data = Reader.View<_ReplayInputData>();
+				if(!Step) {
+					Log.Write("Replay test failed, input at %fs doesn't match a step", Event.Timestamp);
+					Failures++;
+					break;
+				}
+				Step->HasPacket = true;
+				Step->Packet = *Data;
+			} break;
+			case _Replay::PACKET_KEYFRAME:
+				SavedReplay.SkipPacket(Event.Type);
+
+				// Movement after a keyframe isn't delta encoded against earlier samples
+				for(auto &Base : Bases)
+					Base.second.Reset();
+			break;
+			case _Replay::PACKET_CREATE:
+			case _Replay::PACKET_CAMERA:
+			case _Replay::PACKET_ORBDEACTIVATE:
+			case _Replay::PACKET_PLAYERSPEED:
+			case _Replay::PACKET_HASH:
+				SavedReplay.SkipPacket(Event.Type);
+			break;
+			default:
+				Log.Write("Replay test failed, unknown packet %d at %fs", Event.Type, Event.Timestamp);
+				Failures++;
+			break;
+		}
+
+		if(Failures >= 10)
+			break;
+
+		SavedReplay.ReadEvent(Event);
+	}
+	SavedReplay.StopReplay();
+	remove(Path.c_str());
+
+	// Replaying keeps the last input packet until the next one, which has to give back the input of every step and jump on the same steps
+	const _ReplayInputData *CurrentInput = nullptr;
+	int InputPackets = 0;
+	for(size_t i = 0; i < Steps.size() && Failures < 10; i++) {
+		const _ReplayTestStep &Step = Steps[i];
+		if(Step.HasPacket) {
+			CurrentInput = &Step.Packet;
+			InputPackets++;
+		}
+
+		bool Jumped = Step.HasPacket && Step.Packet.Jumped;
+		if(!CurrentInput || CurrentInput->PushX != Step.Input.PushX || CurrentInput->PushZ != Step.Input.PushZ || CurrentInput->Yaw != Step.Input.Yaw || CurrentInput->Pitch != Step.Input.Pitch || Jumped != Step.Input.Jumped) {
+			Log.Write("Replay test failed, input at step %d doesn't match", (int)i + 1);
+			Failures++;
+		}
+	}
+
+	if(Failures)
+		return;
+
+	ExitCode = 0;
+	Log.Write("Replay test passed after %d steps, samples=%d inputs=%d/%d jumps=%d size=%d/%d max error position=%g rotation=%g", (int)Steps.size(), Samples, InputPackets, (int)Steps.size(), Jumps, (int)FileSize, (int)RawSize, MaxPositionError, MaxRotationError);
+}
+
 // Resets the graphics for a state
 void _Framework::ResetGraphics() {
 	Graphics.SetClearColor(video::SColor(0, 0, 0, 0));
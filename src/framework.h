@@ -22,6 +22,10 @@
 
 // Constants
 const float FADE_SPEED = 5.0f;
+const int SIMULATE_DEFAULT_STEPS = 30000;
+const int SNAPSHOT_TEST_DIVERGE_STEPS = 60;
+const int REPLAY_TEST_INPUT_INTERVAL = 50;
+const int REPLAY_TEST_JUMP_CHANCE = 200;
 
 // Forward Declarations
 class _State;
@@ -43,6 +47,8 @@ class _Framework {
 
 		bool IsDone() { return Done; }
 		void SetDone(bool Value) { Done = Value; }
+		bool IsSimulating() { return Simulating; }
+		int GetExitCode() { return ExitCode; }
 
 		ManagerStateType GetManagerState() { return ManagerState; }
 		void ChangeState(_State *State);
@@ -64,6 +70,9 @@ class _Framework {
 	private:
 
 		void ResetGraphics();
+		void Simulate();
+		void TestSnapshot();
+		void TestReplay();
 
 		// States
 		ManagerStateType ManagerState;
@@ -72,6 +81,18 @@ class _Framework {
 
 		// Flags
 		bool Done, MouseWasLocked;
+		int ExitCode;
+
+		// Headless simulation
+		bool Simulating;
+		bool SnapshotTesting;
+		bool ReplayTesting;
+		int SimulateSteps;
+
+		// Batch replay validation
+		std::string Executable;
+		std::string ValidatePath;
+		int ValidateJobs;
 
 		// Time
 		std::chrono::high_resolution_clock::time_point Timestamp;
@@ -23,6 +23,7 @@
 #include <log.h>
 #include <fader.h>
 #include <config.h>
+#include <profiler.h>
 #include <irrlicht.h>
 #include <irrb/CIrrBMeshFileLoader.h>
 #include <string>
@@ -175,8 +176,10 @@ void _Graphics::LoadShaders() {
 void _Graphics::BeginFrame() {
 	irrDriver->beginScene(true, true, ClearColor);
 
-	if(DrawScene)
+	if(DrawScene) {
+		_ProfilerScope Scope(_Profiler::SECTION_SCENE);
 		irrScene->drawAll();
+	}
 }
 
 // Draws the buffer to the screen
@@ -18,6 +18,7 @@
 #include <interface.h>
 #include <globals.h>
 #include <config.h>
+#include <profiler.h>
 #include <log.h>
 #include <audio.h>
 #include <level.h>
@@ -357,6 +358,24 @@ void _Interface::RenderFPS(int PositionX, int PositionY) {
 	//Interface.RenderText(Buffer, PositionX, PositionY + 25, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
 }
 
+// Draw average frame timings in milliseconds
+void _Interface::RenderProfiler(int PositionX, int PositionY) {
+	_Profiler::_Frame Average;
+	Profiler.GetAverage(Average);
+
+	char Buffer[64];
+	int Spacing = 18 * GetUIScale();
+	sprintf(Buffer, "Frame %.2f ms, %d steps", Average.FrameTime * 1000.0, Average.Steps);
+	Interface.RenderText(Buffer, PositionX, PositionY, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
+
+	// Draw sections
+	for(int i = 0; i < _Profiler::SECTION_COUNT; i++) {
+		PositionY += Spacing;
+		sprintf(Buffer, "%-10s %.3f ms", _Profiler::GetSectionName(i), Average.Times[i] * 1000.0);
+		Interface.RenderText(Buffer, PositionX, PositionY, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
+	}
+}
+
 // Draws an interface image centered around a position
 void _Interface::DrawImage(ImageType Type, int PositionX, int PositionY, int Width, int Height, const video::SColor &Color) {
 
@@ -236,6 +236,7 @@ int _Level::Init(const std::string &LevelName, bool HeaderOnly) {
 
 			// Get collision friction
 			CollisionElement->QueryFloatAttribute("friction", &Template->Friction);
+			CollisionElement->QueryIntAttribute("contacts", &Template->MaxContacts);
 
 			// Create spawn
 			_ObjectSpawn *ObjectSpawn = new _ObjectSpawn;
@@ -373,6 +374,9 @@ int _Level::Init(const std::string &LevelName, bool HeaderOnly) {
 		}
 	}
 
+	// Precompute contact surfaces
+	BuildSurfacePairs();
+
 	return 1;
 }
 
@@ -393,6 +397,7 @@ int _Level::Close() {
 		delete Templates[i];
 
 	Templates.clear();
+	SurfacePairs.clear();
 
 	// Delete object spawn data
 	for(size_t i = 0; i < ObjectSpawns.size(); i++)
@@ -409,6 +414,11 @@ int _Level::Close() {
 	return 1;
 }
 
+// Get path to a cache file for an object in this level
+std::string _Level::GetCachePath(const std::string &ObjectName) const {
+	return Save.CachePath + LevelName + "_" + std::to_string(LevelVersion) + "_" + ObjectName + ".cache";
+}
+
 // Processes a template tag
 int _Level::GetTemplateProperties(XMLElement *TemplateElement, _Template &Template) {
 	XMLElement *Element;
@@ -515,6 +525,7 @@ int _Level::GetTemplateProperties(XMLElement *TemplateElement, _Template &Templa
 	if(Element) {
 		Element->QueryIntAttribute("group", &Template.CollisionGroup);
 		Element->QueryIntAttribute("mask", &Template.CollisionMask);
+		Element->QueryIntAttribute("contacts", &Template.MaxContacts);
 		String = Element->Attribute("callback");
 		if(String)
 			Template.CollisionCallback = String;
@@ -766,10 +777,10 @@ int _Level::GetConstraintSpawnProperties(XMLElement *ConstraintElement, _Constra
 // Spawns all of the objects and constraints in the level
 void _Level::SpawnEntities() {
 
-	// Create objects
+	// Create objects, static geometry is kept until the level closes
 	for(size_t i = 0; i < ObjectSpawns.size(); i++) {
 		_ObjectSpawn *Spawn = ObjectSpawns[i];
-		CreateObject(*Spawn);
+		ObjectManager.AddResidentObject(*Spawn, CreateObject(*Spawn));
 	}
 
 	// Create constraints
@@ -784,60 +795,97 @@ void _Level::SpawnEntities() {
 // Creates an object from a spawn struct
 _Object *_Level::CreateObject(const _ObjectSpawn &Object) {
 
-	// Add object
-	_Object *NewObject = nullptr;
-	switch(Object.Template->Type) {
-		case _Object::PLAYER:
-			NewObject = ObjectManager.AddObject(new _Player(Object));
-		break;
-		case _Object::ORB:
-			NewObject = ObjectManager.AddObject(new _Orb(Object));
-		break;
-		case _Object::COLLISION:
-			NewObject = ObjectManager.AddObject(new _Trimesh(Object));
-		break;
-		case _Object::PLANE:
-			NewObject = ObjectManager.AddObject(new _Plane(Object));
-		break;
-		case _Object::SPHERE:
-			NewObject = ObjectManager.AddObject(new _Sphere(Object));
-		break;
-		case _Object::BOX:
-			NewObject = ObjectManager.AddObject(new _Box(Object));
-		break;
-		case _Object::CYLINDER:
-			NewObject = ObjectManager.AddObject(new _Cylinder(Object));
-		break;
-		case _Object::TERRAIN:
-			NewObject = ObjectManager.AddObject(new _Terrain(Object));
-		break;
-		case _Object::ZONE:
-			NewObject = ObjectManager.AddObject(new _Zone(Object));
-		break;
+	// Reuse level geometry kept from before a reset or a recycled object when available
+	_Object *NewObject = ObjectManager.GetResidentObject(Object);
+	if(!NewObject)
+		NewObject = ObjectManager.GetPooledObject(Object);
+	if(NewObject) {
+		ObjectManager.AddObject(NewObject);
+	}
+	else {
+
+		// Add object
+		switch(Object.Template->Type) {
+			case _Object::PLAYER:
+				NewObject = ObjectManager.AddObject(new _Player(Object));
+			break;
+			case _Object::ORB:
+				NewObject = ObjectManager.AddObject(new _Orb(Object));
+			break;
+			case _Object::COLLISION:
+				NewObject = ObjectManager.AddObject(new _Trimesh(Object));
+			break;
+			case _Object::PLANE:
+				NewObject = ObjectManager.AddObject(new _Plane(Object));
+			break;
+			case _Object::SPHERE:
+				NewObject = ObjectManager.AddObject(new _Sphere(Object));
+			break;
+			case _Object::BOX:
+				NewObject = ObjectManager.AddObject(new _Box(Object));
+			break;
+			case _Object::CYLINDER:
+				NewObject = ObjectManager.AddObject(new _Cylinder(Object));
+			break;
+			case _Object::TERRAIN:
+				NewObject = ObjectManager.AddObject(new _Terrain(Object));
+			break;
+			case _Object::ZONE:
+				NewObject = ObjectManager.AddObject(new _Zone(Object));
+			break;
+		}
 	}
 
+	// Get Lua collision handler
+	if(NewObject)
+		NewObject->UpdateCollisionHandler();
+
 	// Record replay event
-	if(Replay.IsRecording() && Object.Template->TemplateID != -1) {
-
-		// Write replay information
-		std::fstream &ReplayFile = Replay.GetFile();
-		Replay.WriteEvent(_Replay::PACKET_CREATE);
-		ReplayFile.write((char *)&Object.Template->TemplateID, sizeof(Object.Template->TemplateID));
-		ReplayFile.write((char *)&NewObject->GetID(), sizeof(NewObject->GetID()));
-		if(Object.Template->Type == _Object::PLANE) {
-			ReplayFile.put(1);
-			ReplayFile.write((char *)&Object.Plane, sizeof(float) * 4);
-		}
-		else {
-			ReplayFile.put(0);
-			ReplayFile.write((char *)&Object.Position, sizeof(float) * 3);
-		}
-		ReplayFile.write((char *)&Object.Rotation, sizeof(float) * 3);
-	}
+	if(NewObject)
+		RecordCreate(Object, NewObject);
 
 	return NewObject;
 }
 
+// Writes the create event for an object to the replay
+void _Level::RecordCreate(const _ObjectSpawn &Object, const _Object *NewObject) {
+	if(!Replay.IsRecording() || Object.Template->TemplateID == -1)
+		return;
+
+	// Write replay information
+	_ReplayWriter &ReplayWriter = Replay.GetWriter();
+	Replay.WriteEvent(_Replay::PACKET_CREATE);
+	ReplayWriter.Put(Object.Template->TemplateID);
+	ReplayWriter.Put(NewObject->GetID());
+	if(Object.Template->Type == _Object::PLANE) {
+		ReplayWriter.Put<char>(1);
+		ReplayWriter.PutData(&Object.Plane, sizeof(float) * 4);
+	}
+	else {
+		ReplayWriter.Put<char>(0);
+		ReplayWriter.PutData(&Object.Position, sizeof(float) * 3);
+	}
+	ReplayWriter.PutData(&Object.Rotation, sizeof(float) * 3);
+}
+
+// Writes create events for level objects that were restored instead of spawned again
+void _Level::RecordSpawnEvents() {
+	if(!Replay.IsRecording())
+		return;
+
+	// Spawned objects come first and in spawn order, spawns of other types don't create objects
+	const std::vector<_Object *> &Objects = ObjectManager.GetObjects();
+	size_t Index = 0;
+	for(size_t i = 0; i < ObjectSpawns.size() && Index < Objects.size(); i++) {
+		const _ObjectSpawn *Spawn = ObjectSpawns[i];
+		if(Objects[Index]->GetTemplate() != Spawn->Template)
+			continue;
+
+		RecordCreate(*Spawn, Objects[Index]);
+		Index++;
+	}
+}
+
 // Creates a constraint from a template
 _Object *_Level::CreateConstraint(const _ConstraintSpawn &Constraint) {
 
@@ -873,6 +921,24 @@ _Template *_Level::GetTemplateFromID(int ID) {
 	return nullptr;
 }
 
+// Get the contact surface for two templates
+const _SurfacePair &_Level::GetSurfacePair(const _Template *Template, const _Template *OtherTemplate) const {
+	return SurfacePairs[Template->SurfaceIndex * Templates.size() + OtherTemplate->SurfaceIndex];
+}
+
+// Combine the surface properties of every template pair
+void _Level::BuildSurfacePairs() {
+	size_t Count = Templates.size();
+	SurfacePairs.clear();
+	SurfacePairs.resize(Count * Count);
+
+	for(size_t i = 0; i < Count; i++) {
+		Templates[i]->SurfaceIndex = (int)i;
+		for(size_t j = 0; j < Count; j++)
+			SurfacePairs[i * Count + j] = _Physics::GetSurfacePair(Templates[i], Templates[j]);
+	}
+}
+
 // Runs the level's scripts
 void _Level::RunScripts() {
 
@@ -893,4 +959,7 @@ void _Level::RunScripts() {
 		// Load a level
 		Scripting.LoadFile(Scripts[i]);
 	}
+
+	// Resolve collision handlers defined by the scripts
+	ObjectManager.UpdateCollisionHandlers();
 }
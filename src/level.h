@@ -18,6 +18,7 @@
 #pragma once
 #include <ISceneNode.h>
 #include <ISceneUserDataSerializer.h>
+#include <physics.h>
 #include <string>
 #include <vector>
 
@@ -51,14 +52,19 @@ class _Level {
 		void SpawnEntities();
 		_Object *CreateObject(const _ObjectSpawn &Object);
 		_Object *CreateConstraint(const _ConstraintSpawn &Constraint);
+		void RecordSpawnEvents();
 
 		// Templates
 		_Template *GetTemplate(const std::string &Name);
 		_Template *GetTemplateFromID(int ID);
+		const _SurfacePair &GetSurfacePair(const _Template *Template, const _Template *OtherTemplate) const;
 
 		// Scripts
 		void RunScripts();
 
+		// Cache
+		std::string GetCachePath(const std::string &ObjectName) const;
+
 		// Attributes
 		std::string LevelName;
 		std::string LevelNiceName;
@@ -75,6 +81,10 @@ class _Level {
 		int GetTemplateProperties(tinyxml2::XMLElement *TemplateElement, _Template &Template);
 		int GetObjectSpawnProperties(tinyxml2::XMLElement *ObjectElement, _ObjectSpawn &ObjectSpawn);
 		int GetConstraintSpawnProperties(tinyxml2::XMLElement *ConstraintElement, _ConstraintSpawn &ConstraintSpawn);
+		void BuildSurfacePairs();
+
+		// Replays
+		void RecordCreate(const _ObjectSpawn &Object, const _Object *NewObject);
 
 		// Custom levels
 		std::string CustomDataPath;
@@ -87,6 +97,9 @@ class _Level {
 		std::vector<_Template *> Templates;
 		std::vector<_ObjectSpawn *> ObjectSpawns;
 		std::vector<_ConstraintSpawn *> ConstraintSpawns;
+
+		// Contact surfaces indexed by template pair
+		std::vector<_SurfacePair> SurfacePairs;
 };
 
 // Singletons
@@ -39,6 +39,7 @@
 #include <IGUIEditBox.h>
 #include <IFileSystem.h>
 #include <algorithm>
+#include <sys/stat.h>
 
 using namespace irr;
 
@@ -91,16 +92,6 @@ enum GUIElements {
 	WIN_RESTARTLEVEL, WIN_NEXTLEVEL, WIN_SAVEREPLAY, WIN_MAINMENU,
 };
 
-// Compare function for sorting replays by timestamp
-bool CompareReplaysTimestamp(const _ReplayInfo &Left, const _ReplayInfo &Right) {
-	return Left.Timestamp > Right.Timestamp;
-}
-
-// Compare function for sorting replays by level, then timestamp
-bool CompareReplaysLevel(const _ReplayInfo &Left, const _ReplayInfo &Right) {
-	return Left.LevelName < Right.LevelName || (Left.LevelName == Right.LevelName && Left.Timestamp > Right.Timestamp);
-}
-
 // Handle action inputs
 bool _Menu::HandleAction(int InputType, int Action, float Value) {
 	if(Input.HasJoystick())
@@ -325,6 +316,7 @@ void _Menu::HandleGUI(irr::gui::EGUI_EVENT_TYPE EventType, gui::IGUIElement *Ele
 						// Remove file
 						std::string FilePath = Save.ReplayPath + FileName;
 						remove(FilePath.c_str());
+						Save.UpdateReplayIndex(std::vector<_ReplayIndex>(), std::vector<std::string>(1, FileName));
 
 						// Refresh screen
 						InitReplays(true);
@@ -774,59 +766,118 @@ void _Menu::InitReplays(bool LoadReplays) {
 	// Load replay files
 	if(LoadReplays) {
 
+		// Get indexed replay headers
+		std::vector<_ReplayIndex> Replays;
+		Save.GetReplayIndex(Replays, false);
+		std::map<std::string, const _ReplayIndex *> IndexedFiles;
+		for(const auto &Index : Replays)
+			IndexedFiles[Index.Filename] = &Index;
+
 		// Change directories
 		std::string OldWorkingDirectory(irrFile->getWorkingDirectory().c_str());
 		irrFile->changeWorkingDirectoryTo(Save.ReplayPath.c_str());
 
-		// Clear list
-		ReplayFiles.clear();
-
-		// Get a list of replays
+		// Find new or modified replays
+		std::vector<_ReplayIndex> ChangedReplays;
 		io::IFileList *FileList = irrFile->createFileList();
 		uint32_t FileCount = FileList->getFileCount();
 		for(uint32_t i = 0; i < FileCount; i++) {
-			if(!FileList->isDirectory(i) && FileList->getFileName(i).find(".replay") != -1) {
-
-				// Load header
-				bool Loaded = Replay.LoadReplay(FileList->getFileName(i).c_str(), true);
-				if(Loaded && Replay.GetVersion() == REPLAY_VERSION && Replay.GetTimeStep() == PHYSICS_TIMESTEP) {
-					char Buffer[256];
-
-					// Get level info
-					Level.Init(Replay.GetLevelName(), true);
-					if(Level.LevelVersion > Replay.GetLevelVersion())
-						continue;
-
-					// Get replay info
-					_ReplayInfo ReplayInfo;
-					ReplayInfo.Filename = FileList->getFileName(i).c_str();
-					ReplayInfo.Description = Replay.GetDescription();
-					ReplayInfo.LevelName = Level.LevelName;
-					ReplayInfo.LevelNiceName = Level.LevelNiceName;
-					ReplayInfo.Autosave = Replay.GetAutosave();
-					ReplayInfo.Won = Replay.GetWon();
-					ReplayInfo.Timestamp = Replay.GetTimestamp();
-					ReplayInfo.Platform = Replay.GetPlatform();
-
-					// Date
-					strftime(Buffer, 32, "%Y-%m-%d %H:%M:%S", localtime(&Replay.GetTimestamp()));
-					ReplayInfo.Date = Buffer;
-
-					// Get time string
-					Interface.ConvertSecondsToString(Replay.GetFinishTime(), Buffer);
-					ReplayInfo.FinishTime = Buffer;
-					ReplayFiles.push_back(ReplayInfo);
+			std::string Filename = FileList->getFileName(i).c_str();
+			if(FileList->isDirectory(i) || Filename.find(".replay") == std::string::npos || Filename.find(".tmp") != std::string::npos)
+				continue;
+
+			// Get modified time
+			struct stat FileStat;
+			if(stat((Save.ReplayPath + Filename).c_str(), &FileStat) != 0)
+				continue;
+
+			// Skip unchanged files
+			auto IndexIterator = IndexedFiles.find(Filename);
+			if(IndexIterator != IndexedFiles.end()) {
+				const _ReplayIndex *Index = IndexIterator->second;
+				IndexedFiles.erase(IndexIterator);
+				if(Index->ModifiedTime == FileStat.st_mtime)
+					continue;
+
+				// Replays saved by the game are indexed before the file is written
+				if(Index->ModifiedTime == 0) {
+					ChangedReplays.push_back(*Index);
+					ChangedReplays.back().ModifiedTime = FileStat.st_mtime;
+					continue;
 				}
 			}
+
+			// Load header
+			_ReplayIndex Index;
+			Index.Filename = Filename;
+			Index.ModifiedTime = FileStat.st_mtime;
+			if(Replay.LoadReplay(Filename, true)) {
+				Index.LevelName = Replay.GetLevelName();
+				Index.Description = Replay.GetDescription();
+				Index.ReplayVersion = Replay.GetVersion();
+				Index.LevelVersion = Replay.GetLevelVersion();
+				Index.TimeStep = Replay.GetTimeStep();
+				Index.FinishTime = Replay.GetFinishTime();
+				Index.Timestamp = Replay.GetTimestamp();
+				Index.Platform = Replay.GetPlatform();
+				Index.Autosave = Replay.GetAutosave();
+				Index.Won = Replay.GetWon();
+			}
+			ChangedReplays.push_back(Index);
 		}
 		FileList->drop();
 		irrFile->changeWorkingDirectoryTo(OldWorkingDirectory.c_str());
 
-		// Sort replays
-		if(ReplaySort == SORT_TIMESTAMP)
-			std::sort(ReplayFiles.begin(), ReplayFiles.end(), CompareReplaysTimestamp);
-		else if(ReplaySort == SORT_LEVELNAME)
-			std::sort(ReplayFiles.begin(), ReplayFiles.end(), CompareReplaysLevel);
+		// Files left in the map were deleted
+		std::vector<std::string> RemovedReplays;
+		for(const auto &Iterator : IndexedFiles)
+			RemovedReplays.push_back(Iterator.first);
+
+		// Update index and get sorted list
+		Save.UpdateReplayIndex(ChangedReplays, RemovedReplays);
+		Save.GetReplayIndex(Replays, ReplaySort == SORT_LEVELNAME);
+
+		// Build list
+		ReplayFiles.clear();
+		for(const auto &Index : Replays) {
+			if(Index.ReplayVersion < REPLAY_MINIMUM_VERSION || Index.ReplayVersion > REPLAY_VERSION || Index.TimeStep != PHYSICS_TIMESTEP)
+				continue;
+
+			// Get level info once per level
+			auto LevelIterator = ReplayLevels.find(Index.LevelName);
+			if(LevelIterator == ReplayLevels.end()) {
+				Level.Init(Index.LevelName, true);
+				_ReplayLevelInfo &LevelInfo = ReplayLevels[Index.LevelName];
+				LevelInfo.Version = Level.LevelVersion;
+				LevelInfo.NiceName = Level.LevelNiceName;
+				LevelIterator = ReplayLevels.find(Index.LevelName);
+			}
+			if(LevelIterator->second.Version > Index.LevelVersion)
+				continue;
+
+			char Buffer[256];
+
+			// Get replay info
+			_ReplayInfo ReplayInfo;
+			ReplayInfo.Filename = Index.Filename;
+			ReplayInfo.Description = Index.Description;
+			ReplayInfo.LevelName = Index.LevelName;
+			ReplayInfo.LevelNiceName = LevelIterator->second.NiceName;
+			ReplayInfo.Autosave = Index.Autosave;
+			ReplayInfo.Won = Index.Won;
+			ReplayInfo.Timestamp = (int)Index.Timestamp;
+			ReplayInfo.Platform = Index.Platform;
+
+			// Date
+			time_t Timestamp = Index.Timestamp;
+			strftime(Buffer, 32, "%Y-%m-%d %H:%M:%S", localtime(&Timestamp));
+			ReplayInfo.Date = Buffer;
+
+			// Get time string
+			Interface.ConvertSecondsToString(Index.FinishTime, Buffer);
+			ReplayInfo.FinishTime = Buffer;
+			ReplayFiles.push_back(ReplayInfo);
+		}
 	}
 
 	// Calculate layout
@@ -23,6 +23,7 @@
 #include <interface.h>
 #include <IGUIButton.h>
 #include <vector>
+#include <map>
 
 // Forward Declarations
 struct _LevelStat;
@@ -41,6 +42,12 @@ struct _ReplayInfo {
 	bool Won;
 };
 
+// Level info cached for the replay list
+struct _ReplayLevelInfo {
+	int Version;
+	std::string NiceName;
+};
+
 // Classes
 class _Menu {
 
@@ -109,6 +116,7 @@ class _Menu {
 		void DrawWinScreen();
 		void ClearCurrentLayout();
 		void SetLoseMessage(const std::string &Message) { LoseMessage = Message; }
+		MenuType GetState() const { return State; }
 
 	private:
 
@@ -128,6 +136,7 @@ class _Menu {
 
 		// Replays
 		std::vector<_ReplayInfo> ReplayFiles;
+		std::map<std::string, _ReplayLevelInfo> ReplayLevels;
 		irr::gui::IGUIElement *SelectedElement;
 		int ReplaySort;
 		uint32_t StartOffset;
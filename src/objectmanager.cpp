@@ -19,7 +19,13 @@
 #include <replay.h>
 #include <level.h>
 #include <physics.h>
+#include <log.h>
 #include <objects/object.h>
+#include <objects/orb.h>
+#include <objects/plane.h>
+#include <objects/template.h>
+#include <algorithm>
+#include <cmath>
 
 using namespace irr;
 
@@ -27,13 +33,17 @@ _ObjectManager ObjectManager;
 
 // Constructor
 _ObjectManager::_ObjectManager() :
-	NextObjectID(0) {
+	NextObjectOrder(0),
+	NextObjectID(0),
+	Generation(0),
+	Pooling(true) {
 
 }
 
 // Initializes the level manager
 int _ObjectManager::Init() {
 
+	NextObjectOrder = 0;
 	NextObjectID = 0;
 
 	return 1;
@@ -52,68 +62,360 @@ _Object *_ObjectManager::AddObject(_Object *Object) {
 
 	if(Object != nullptr) {
 
-		// Set replay ID
+		// Set replay ID, skipping ids still held by live objects once the counter wraps
+		for(size_t i = 0; i < ObjectsByID.size() && NextObjectID < ObjectsByID.size() && !ObjectsByID[NextObjectID].empty(); i++)
+			NextObjectID++;
 		Object->SetID(NextObjectID);
+		Object->SetOrder(NextObjectOrder);
 		NextObjectID++;
+		NextObjectOrder++;
 
 		Objects.push_back(Object);
+		AddToIndex(Object);
 	}
 
 	return Object;
 }
 
+// Adds an object to the lookup tables
+void _ObjectManager::AddToIndex(_Object *Object) {
+
+	// Index by ID, lookups return the first object created with a given ID
+	uint16_t ID = Object->GetID();
+	if(ID >= ObjectsByID.size())
+		ObjectsByID.resize(ID + 1);
+	std::vector<_Object *> &Holders = ObjectsByID[ID];
+	auto Iterator = std::upper_bound(Holders.begin(), Holders.end(), Object, [](const _Object *Value, const _Object *Holder) {
+		return Value->GetOrder() < Holder->GetOrder();
+	});
+	Holders.insert(Iterator, Object);
+
+	// Index by name and type
+	if(Object->GetName() != "")
+		ObjectsByName[Object->GetName()][Object->GetOrder()] = Object;
+	ObjectsByType[Object->GetType()][Object->GetOrder()] = Object;
+}
+
+// Removes an object from the lookup tables
+void _ObjectManager::RemoveFromIndex(_Object *Object) {
+
+	// Remove from ID table, the next object sharing the ID takes over lookups
+	uint16_t ID = Object->GetID();
+	if(ID < ObjectsByID.size()) {
+		std::vector<_Object *> &Holders = ObjectsByID[ID];
+		auto Iterator = std::find(Holders.begin(), Holders.end(), Object);
+		if(Iterator != Holders.end())
+			Holders.erase(Iterator);
+	}
+
+	// Remove from name table
+	if(Object->GetName() != "") {
+		auto NameIterator = ObjectsByName.find(Object->GetName());
+		if(NameIterator != ObjectsByName.end()) {
+			NameIterator->second.erase(Object->GetOrder());
+			if(NameIterator->second.empty())
+				ObjectsByName.erase(NameIterator);
+		}
+	}
+
+	// Remove from type table
+	auto TypeIterator = ObjectsByType.find(Object->GetType());
+	if(TypeIterator != ObjectsByType.end()) {
+		TypeIterator->second.erase(Object->GetOrder());
+		if(TypeIterator->second.empty())
+			ObjectsByType.erase(TypeIterator);
+	}
+}
+
+// Removes an object from the manager without deleting it
+void _ObjectManager::RemoveObject(_Object *Object) {
+
+	// Objects are sorted by creation order
+	auto Iterator = std::lower_bound(Objects.begin(), Objects.end(), Object, [](const _Object *Left, const _Object *Right) {
+		return Left->GetOrder() < Right->GetOrder();
+	});
+	if(Iterator == Objects.end() || *Iterator != Object)
+		return;
+
+	RemoveFromIndex(Object);
+	Objects.erase(Iterator);
+}
+
+// Determines if deleted objects of a type can be reused
+static bool IsPooledType(int Type) {
+	switch(Type) {
+		case _Object::SPHERE:
+		case _Object::BOX:
+		case _Object::CYLINDER:
+			return true;
+	}
+
+	return false;
+}
+
+// Returns a recycled object reset to the spawn state, nullptr if the pool is empty
+_Object *_ObjectManager::GetPooledObject(const _ObjectSpawn &Spawn) {
+	if(!Pooling || !IsPooledType(Spawn.Template->Type))
+		return nullptr;
+
+	auto Iterator = ObjectPools.find(Spawn.Template);
+	if(Iterator == ObjectPools.end() || Iterator->second.empty())
+		return nullptr;
+
+	_Object *Object = Iterator->second.back();
+	Iterator->second.pop_back();
+	Object->Respawn(Spawn);
+
+	return Object;
+}
+
+// Returns an object to its pool or deletes it
+void _ObjectManager::ReleaseObject(_Object *Object) {
+	if(Object->IsResident()) {
+		DeleteResidentObject(Object);
+		return;
+	}
+
+	if(!Pooling || !IsPooledType(Object->GetType())) {
+		delete Object;
+		return;
+	}
+
+	Object->Recycle();
+	ObjectPools[Object->GetTemplate()].push_back(Object);
+}
+
+// Determines if objects of a type are static level geometry that can be kept across resets
+static bool IsResidentType(int Type) {
+	switch(Type) {
+		case _Object::COLLISION:
+		case _Object::TERRAIN:
+		case _Object::PLANE:
+			return true;
+	}
+
+	return false;
+}
+
+// Returns level geometry kept from before a reset, nullptr if the spawn hasn't been created yet
+_Object *_ObjectManager::GetResidentObject(const _ObjectSpawn &Spawn) {
+	auto Iterator = ResidentObjects.find(&Spawn);
+	if(Iterator == ResidentObjects.end())
+		return nullptr;
+
+	_Object *Object = Iterator->second;
+	Object->Respawn(Spawn, false);
+
+	return Object;
+}
+
+// Keeps static level geometry created from a level spawn across resets
+void _ObjectManager::AddResidentObject(const _ObjectSpawn &Spawn, _Object *Object) {
+	if(!Object || Object->IsResident() || !IsResidentType(Object->GetType()) || Object->GetBody())
+		return;
+
+	Object->SetResident(true);
+	ResidentObjects[&Spawn] = Object;
+}
+
+// Deletes a resident object that is no longer part of the level
+void _ObjectManager::DeleteResidentObject(_Object *Object) {
+	for(auto Iterator = ResidentObjects.begin(); Iterator != ResidentObjects.end(); ++Iterator) {
+		if(Iterator->second == Object) {
+			ResidentObjects.erase(Iterator);
+			break;
+		}
+	}
+
+	delete Object;
+}
+
+// Reserves space for objects about to be created
+void _ObjectManager::ReserveObjects(size_t Count) {
+	Objects.reserve(Objects.size() + Count);
+}
+
+// Changes the replay ID of an object
+void _ObjectManager::ChangeObjectID(_Object *Object, int ID) {
+
+	RemoveFromIndex(Object);
+	Object->SetID(ID);
+	AddToIndex(Object);
+}
+
 // Deletes an object
 void _ObjectManager::DeleteObject(_Object *Object) {
 
 	Object->SetDeleted(true);
 }
 
+// Gets an object by creation order
+_Object *_ObjectManager::GetObjectByOrder(uint32_t Order) {
+
+	// Objects are sorted by creation order
+	auto Iterator = std::lower_bound(Objects.begin(), Objects.end(), Order, [](const _Object *Object, uint32_t Value) {
+		return Object->GetOrder() < Value;
+	});
+	if(Iterator == Objects.end() || (*Iterator)->GetOrder() != Order)
+		return nullptr;
+
+	return *Iterator;
+}
+
 // Gets an object by name
 _Object *_ObjectManager::GetObjectByName(const std::string &Name) {
 
-	// Search through object list
-	for(auto &Iterator : Objects) {
-		if(Iterator->GetName() == Name)
-			return Iterator;
-	}
+	auto Iterator = ObjectsByName.find(Name);
+	if(Iterator == ObjectsByName.end())
+		return nullptr;
 
-	return nullptr;
+	return Iterator->second.begin()->second;
 }
 
 // Gets an object by type
 _Object *_ObjectManager::GetObjectByType(int Type) {
 
-	// Search through object list
-	for(auto &Iterator : Objects) {
-		if(Iterator->GetType() == Type)
-			return Iterator;
-	}
+	auto Iterator = ObjectsByType.find(Type);
+	if(Iterator == ObjectsByType.end())
+		return nullptr;
+
+	return Iterator->second.begin()->second;
+}
 
-	return nullptr;
+// Resolves Lua collision handlers for all objects
+void _ObjectManager::UpdateCollisionHandlers() {
+
+	for(auto &Iterator : Objects)
+		Iterator->UpdateCollisionHandler();
 }
 
-// Deletes all of the objects
-void _ObjectManager::ClearObjects() {
+// Deletes all of the objects, optionally keeping resident level geometry out of the world until it's spawned again
+void _ObjectManager::ClearObjects(bool KeepResident) {
 
 	// Delete constraints first
-	for(auto Iterator = Objects.begin(); Iterator != Objects.end(); ) {
-		_Object *Object = *Iterator;
-		if(Object->GetType() == _Object::CONSTRAINT_D6 || Object->GetType() == _Object::CONSTRAINT_HINGE) {
-			delete Object;
-			Object = nullptr;
-			Iterator = Objects.erase(Iterator);
+	for(auto &Iterator : Objects) {
+		if(Iterator->GetType() == _Object::CONSTRAINT_D6 || Iterator->GetType() == _Object::CONSTRAINT_HINGE) {
+			delete Iterator;
+			Iterator = nullptr;
 		}
-		else
-			++Iterator;
 	}
 
 	// Delete objects
 	for(auto &Iterator : Objects) {
-		delete Iterator;
+		if(Iterator && Iterator->IsResident()) {
+			if(!KeepResident)
+				continue;
+
+			if(Iterator->GetDeleted())
+				DeleteResidentObject(Iterator);
+			else
+				Iterator->Recycle();
+		}
+		else
+			delete Iterator;
+	}
+
+	// Delete resident objects
+	if(!KeepResident) {
+		for(auto &Iterator : ResidentObjects)
+			delete Iterator.second;
+		ResidentObjects.clear();
+	}
+
+	// Delete recycled objects
+	for(auto &Pool : ObjectPools) {
+		for(auto &Iterator : Pool.second)
+			delete Iterator;
 	}
 
 	Objects.clear();
+	ObjectPools.clear();
+	ObjectsByID.clear();
+	ObjectsByName.clear();
+	ObjectsByType.clear();
+	NextObjectOrder = 0;
 	NextObjectID = 0;
+	Generation++;
+}
+
+// Writes the state of every object to a snapshot
+void _ObjectManager::Snapshot(_PhysicsSnapshot &Snapshot) {
+	Snapshot.Put(Generation);
+	Snapshot.Put(NextObjectOrder);
+	Snapshot.Put(NextObjectID);
+
+	// Objects in the snapshot
+	Snapshot.Put((uint32_t)Objects.size());
+	for(auto &Iterator : Objects)
+		Snapshot.Put(Iterator->GetOrder());
+
+	// Object state
+	for(auto &Iterator : Objects) {
+		Snapshot.Put(Iterator->GetID());
+		Iterator->SaveState(Snapshot);
+	}
+}
+
+// Restores objects from a snapshot, deleting any created since. Returns false without changes if an object in the
+// snapshot is gone, or false with objects partly restored if the snapshot is truncated.
+bool _ObjectManager::Restore(_PhysicsSnapshot &Snapshot) {
+	if(Snapshot.Get<uint32_t>() != Generation)
+		return false;
+
+	uint32_t SnapshotObjectOrder = Snapshot.Get<uint32_t>();
+	uint16_t SnapshotObjectID = Snapshot.Get<uint16_t>();
+	uint32_t Count = Snapshot.Get<uint32_t>();
+	if(Snapshot.IsOverrun() || Count > Objects.size())
+		return false;
+
+	// Objects created before the snapshot must match it exactly
+	for(uint32_t i = 0; i < Count; i++) {
+		if(Snapshot.Get<uint32_t>() != Objects[i]->GetOrder())
+			return false;
+	}
+	if(Snapshot.IsOverrun())
+		return false;
+
+	// Remove newer objects, constraints first since they hold joints to bodies
+	std::vector<_Object *> NewObjects(Objects.begin() + Count, Objects.end());
+	Objects.resize(Count);
+	for(auto &Iterator : NewObjects) {
+		RemoveFromIndex(Iterator);
+		if(Iterator->GetType() == _Object::CONSTRAINT_D6 || Iterator->GetType() == _Object::CONSTRAINT_HINGE || Iterator->GetType() == _Object::CONSTRAINT_FIXED) {
+			delete Iterator;
+			Iterator = nullptr;
+		}
+	}
+	for(auto &Iterator : NewObjects) {
+		if(Iterator && Iterator->IsResident())
+			DeleteResidentObject(Iterator);
+		else
+			delete Iterator;
+	}
+
+	// Recycled objects would be reused in a different order than new ones
+	for(auto &Pool : ObjectPools) {
+		for(auto &Iterator : Pool.second)
+			delete Iterator;
+	}
+	ObjectPools.clear();
+
+	// Restore object state
+	NextObjectOrder = SnapshotObjectOrder;
+	NextObjectID = SnapshotObjectID;
+	for(auto &Iterator : Objects) {
+		uint16_t ID = Snapshot.Get<uint16_t>();
+		if(ID != Iterator->GetID())
+			ChangeObjectID(Iterator, ID);
+		Iterator->LoadState(Snapshot);
+	}
+
+	if(Snapshot.IsOverrun()) {
+		Log.Write("_ObjectManager::Restore - Snapshot is truncated");
+		return false;
+	}
+
+	return true;
 }
 
 // Performs start frame operations on the objects
@@ -144,22 +446,21 @@ void _ObjectManager::EndFrame() {
 	if(UpdateReplay && ReplayMovementCount > 0) {
 
 		// Write replay event
-		std::fstream &ReplayFile = Replay.GetFile();
+		_ReplayWriter &ReplayWriter = Replay.GetWriter();
 		Replay.WriteEvent(_Replay::PACKET_MOVEMENT);
-		ReplayFile.write((char *)&ReplayMovementCount, sizeof(ReplayMovementCount));
+		ReplayWriter.Put(ReplayMovementCount);
 
 		// Write the updated objects
 		for(auto &Iterator : Objects) {
 
 			// Save the replay
 			if(Iterator->ReadyForReplayUpdate()) {
-				glm::vec3 Rotation = Physics.QuaternionToEuler(Iterator->GetQuaternion());
-				glm::vec3 Position = Iterator->GetPosition();
+				_ReplayOrientation Orientation;
+				Orientation.Set(Iterator->GetPosition(), Iterator->GetQuaternion());
 
 				// Write object update
-				ReplayFile.write((char *)&Iterator->GetID(), sizeof(Iterator->GetID()));
-				ReplayFile.write((char *)&Position[0], sizeof(float) * 3);
-				ReplayFile.write((char *)&Rotation[0], sizeof(float) * 3);
+				ReplayWriter.Put(Iterator->GetID());
+				Replay.WriteMovement(Orientation, Iterator->GetReplayBase());
 				Iterator->WroteReplayPacket();
 			}
 		}
@@ -169,9 +470,10 @@ void _ObjectManager::EndFrame() {
 // Updates all objects in the scene
 void _ObjectManager::Update(float FrameTime) {
 
-	// Update objects
-	for(auto Iterator = Objects.begin(); Iterator != Objects.end(); ) {
-		_Object *Object = *Iterator;
+	// Update objects, compacting the list in place as objects are deleted
+	size_t Kept = 0;
+	for(size_t i = 0; i < Objects.size(); i++) {
+		_Object *Object = Objects[i];
 
 		// Update the object
 		Object->Update(FrameTime);
@@ -181,19 +483,172 @@ void _ObjectManager::Update(float FrameTime) {
 
 			// Write delete events to the replay
 			if(Replay.IsRecording()) {
-				std::fstream &ReplayFile = Replay.GetFile();
 				Replay.WriteEvent(_Replay::PACKET_DELETE);
-				ReplayFile.write((char *)&Object->GetID(), sizeof(Object->GetID()));
+				Replay.GetWriter().Put(Object->GetID());
 			}
 
-			delete Object;
-			Iterator = Objects.erase(Iterator);
+			RemoveFromIndex(Object);
+			Objects[i] = nullptr;
+			ReleaseObject(Object);
+		}
+		else {
+
+			Objects[Kept++] = Object;
+		}
+	}
+	Objects.resize(Kept);
+}
+
+// Determines if an object is recreated from replay create events
+static bool IsReplayObject(const _Object *Object) {
+	if(Object->GetTemplate()->TemplateID == -1)
+		return false;
+
+	switch(Object->GetType()) {
+		case _Object::CONSTRAINT_FIXED:
+		case _Object::CONSTRAINT_HINGE:
+		case _Object::CONSTRAINT_D6:
+			return false;
+	}
+
+	return true;
+}
+
+// Writes the full state of every replayed object
+void _ObjectManager::WriteKeyframe() {
+	_ReplayWriter &ReplayWriter = Replay.GetWriter();
+
+	// Write count of objects that have create events
+	int16_t ObjectCount = 0;
+	for(auto &Iterator : Objects) {
+		if(IsReplayObject(Iterator))
+			ObjectCount++;
+	}
+	ReplayWriter.Put(ObjectCount);
+
+	// Write objects
+	for(auto &Iterator : Objects) {
+		if(!IsReplayObject(Iterator))
+			continue;
+
+		// Next movement packet starts from the keyframe
+		Iterator->GetReplayBase().Reset();
+
+		ReplayWriter.Put(Iterator->GetTemplate()->TemplateID);
+		ReplayWriter.Put(Iterator->GetID());
+
+		// Write orientation
+		glm::vec4 Position(0.0f);
+		glm::vec3 Rotation(0.0f);
+		if(Iterator->GetType() == _Object::PLANE) {
+			ReplayWriter.Put<char>(1);
+			Position = static_cast<_Plane *>(Iterator)->GetPlane();
 		}
 		else {
+			ReplayWriter.Put<char>(0);
+			Position = glm::vec4(Iterator->GetPosition(), 0.0f);
+			Rotation = Physics.QuaternionToEuler(Iterator->GetQuaternion());
+		}
+		ReplayWriter.PutData(&Position[0], sizeof(float) * 4);
+		ReplayWriter.PutData(&Rotation[0], sizeof(float) * 3);
+
+		// Write orb state
+		uint8_t OrbState = 0;
+		float OrbTime = 0.0f;
+		float DeactivateLength = 0.0f;
+		if(Iterator->GetType() == _Object::ORB) {
+			_Orb *Orb = static_cast<_Orb *>(Iterator);
+			OrbState = (uint8_t)Orb->GetState();
+			OrbTime = Orb->GetOrbTime();
+			DeactivateLength = Orb->GetDeactivateLength();
+		}
+		ReplayWriter.Put(OrbState);
+		ReplayWriter.Put(OrbTime);
+		ReplayWriter.Put(DeactivateLength);
+	}
+}
+
+// Adds data to an FNV-1a hash
+static uint32_t HashData(uint32_t Hash, const void *Data, size_t Size) {
+	const uint8_t *Bytes = (const uint8_t *)Data;
+	for(size_t i = 0; i < Size; i++) {
+		Hash ^= Bytes[i];
+		Hash *= 16777619u;
+	}
+
+	return Hash;
+}
+
+// Hashes the quantized position, rotation and velocities of every body and returns the world hash
+uint32_t _ObjectManager::GetStateHash(std::vector<_ReplayObjectHash> &ObjectHashes) {
+	ObjectHashes.clear();
 
-			++Iterator;
+	uint32_t WorldHash = 2166136261u;
+	for(auto &Iterator : Objects) {
+		if(!Iterator->GetBody())
+			continue;
+
+		// Quantize state
+		glm::vec3 Position = Iterator->GetPosition();
+		glm::quat Rotation = Iterator->GetQuaternion();
+		glm::vec3 LinearVelocity = Iterator->GetLinearVelocity();
+		glm::vec3 AngularVelocity = Iterator->GetAngularVelocity();
+		int32_t Values[13];
+		for(int i = 0; i < 3; i++) {
+			Values[i] = (int32_t)std::lround(Position[i] * REPLAY_POSITION_SCALE);
+			Values[i + 3] = (int32_t)std::lround(LinearVelocity[i] * REPLAY_POSITION_SCALE);
+			Values[i + 6] = (int32_t)std::lround(AngularVelocity[i] * REPLAY_POSITION_SCALE);
 		}
+		for(int i = 0; i < 4; i++)
+			Values[i + 9] = (int32_t)std::lround(Rotation[i] * REPLAY_ROTATION_SCALE);
+
+		// Add to world hash
+		uint32_t Hash = HashData(2166136261u, Values, sizeof(Values));
+		uint16_t ObjectID = Iterator->GetID();
+		WorldHash = HashData(WorldHash, &ObjectID, sizeof(ObjectID));
+		WorldHash = HashData(WorldHash, &Hash, sizeof(Hash));
+
+		_ReplayObjectHash ObjectHash;
+		ObjectHash.ObjectID = ObjectID;
+		ObjectHash.Hash = (uint16_t)(Hash ^ (Hash >> 16));
+		ObjectHashes.push_back(ObjectHash);
 	}
+
+	return WorldHash;
+}
+
+// Hashes the raw ODE state of every body, exact where GetStateHash is quantized
+uint32_t _ObjectManager::GetBodyStateHash() {
+	uint32_t Hash = 2166136261u;
+	std::vector<char> State;
+	for(auto &Iterator : Objects) {
+		dBodyID Body = Iterator->GetBody();
+		if(!Body)
+			continue;
+
+		// Padding in the state is left zeroed
+		State.assign(dBodyGetStateSize(Body), 0);
+		dBodyGetState(Body, State.data());
+
+		uint32_t Order = Iterator->GetOrder();
+		Hash = HashData(Hash, &Order, sizeof(Order));
+		Hash = HashData(Hash, State.data(), State.size());
+	}
+
+	return Hash;
+}
+
+// Writes the world hash followed by the hash of each body
+void _ObjectManager::WriteHash() {
+	std::vector<_ReplayObjectHash> ObjectHashes;
+	uint32_t WorldHash = GetStateHash(ObjectHashes);
+
+	_ReplayWriter &ReplayWriter = Replay.GetWriter();
+	Replay.WriteEvent(_Replay::PACKET_HASH);
+	ReplayWriter.Put(WorldHash);
+	ReplayWriter.Put((uint16_t)ObjectHashes.size());
+	for(const auto &ObjectHash : ObjectHashes)
+		ReplayWriter.Put(ObjectHash);
 }
 
 // Update special replays function for each object
@@ -206,38 +661,67 @@ void _ObjectManager::UpdateReplay(float FrameTime) {
 
 // Updates all objects in the scene from a replay file
 void _ObjectManager::UpdateFromReplay() {
-	core::vector3df Position, Rotation;
 
-	// Get replay stream and read object count
-	std::fstream &ReplayFile = Replay.GetFile();
-	int16_t ObjectCount;
-	ReplayFile.read((char *)&ObjectCount, sizeof(ObjectCount));
+	// Get replay reader and read object count
+	_ReplayReader &ReplayReader = Replay.GetReader();
+	int16_t ObjectCount = ReplayReader.Get<int16_t>();
+
+	// Read delta encoded movement
+	if(Replay.GetVersion() >= 6) {
+
+		// Objects are written in list order
+		auto Iterator = Objects.begin();
+		for(int i = 0; i < ObjectCount; i++) {
+			uint16_t ObjectID = ReplayReader.Get<uint16_t>();
+			while(Iterator != Objects.end() && (*Iterator)->GetID() != ObjectID)
+				++Iterator;
+
+			// Skip unknown objects
+			if(Iterator == Objects.end()) {
+				_ReplayOrientation Unused;
+				ReplayReader.GetMovement(Unused);
+				Iterator = Objects.begin();
+				continue;
+			}
+
+			// Decode sample, the node is moved once per rendered frame
+			_Object *Object = *Iterator;
+			ReplayReader.GetMovement(Object->GetReplayBase());
+
+			glm::vec3 DecodedPosition;
+			glm::quat DecodedRotation;
+			Object->GetReplayBase().Get(DecodedPosition, DecodedRotation);
+			Object->SetReplayOrientation(DecodedPosition, DecodedRotation);
+		}
+
+		return;
+	}
 
 	// Read first object
-	int16_t ObjectID;
-	ReplayFile.read((char *)&ObjectID, sizeof(ObjectID));
-	ReplayFile.read((char *)&Position.X, sizeof(float) * 3);
-	ReplayFile.read((char *)&Rotation.X, sizeof(float) * 3);
+	const _ReplayMovementData *Data = ReplayReader.View<_ReplayMovementData>();
 
 	// Loop through the rest of the objects
 	int UpdatedObjectCount = 0;
 	for(auto &Iterator : Objects) {
-		if(ObjectID == Iterator->GetID()) {
-			Iterator->SetPositionFromReplay(Position);
-			Iterator->GetNode()->setRotation(Rotation);
-
-			//printf("ObjectPacket ObjectID=%d Type=%d Position=%f %f %f Rotation=%f %f %f\n", ObjectID, Object->GetType(), Position.X, Position.Y, Position.Z, Rotation.X, Rotation.Y, Rotation.Z);
-			if(UpdatedObjectCount < ObjectCount - 1) {
-				ReplayFile.read((char *)&ObjectID, sizeof(ObjectID));
-				ReplayFile.read((char *)&Position.X, sizeof(float) * 3);
-				ReplayFile.read((char *)&Rotation.X, sizeof(float) * 3);
-			}
+		if(Data->ObjectID == Iterator->GetID()) {
+			Iterator->SetReplayOrientation(glm::vec3(Data->Position[0], Data->Position[1], Data->Position[2]), glm::vec3(Data->Rotation[0], Data->Rotation[1], Data->Rotation[2]));
+
+			//printf("ObjectPacket ObjectID=%d Type=%d Position=%f %f %f Rotation=%f %f %f\n", Data->ObjectID, Iterator->GetType(), Data->Position[0], Data->Position[1], Data->Position[2], Data->Rotation[0], Data->Rotation[1], Data->Rotation[2]);
+			if(UpdatedObjectCount < ObjectCount - 1)
+				Data = ReplayReader.View<_ReplayMovementData>();
 
 			UpdatedObjectCount++;
 		}
 	}
 }
 
+// Move scene nodes to the last replay movement of each object
+void _ObjectManager::ApplyReplayOrientations() {
+
+	for(auto &Iterator : Objects)
+		Iterator->ApplyReplayOrientation();
+}
+
 // Interpolate between last and current orientation for every object
 void _ObjectManager::InterpolateOrientations(float BlendFactor) {
 
@@ -248,12 +732,10 @@ void _ObjectManager::InterpolateOrientations(float BlendFactor) {
 // Returns an object by an index, nullptr if no such index
 _Object *_ObjectManager::GetObjectByID(int ID) {
 
-	for(auto &Iterator : Objects) {
-		if(Iterator->GetID() == ID)
-			return Iterator;
-	}
+	if(ID < 0 || ID >= (int)ObjectsByID.size() || ObjectsByID[ID].empty())
+		return nullptr;
 
-	return nullptr;
+	return ObjectsByID[ID].front();
 }
 
 // Print all object orientations
@@ -266,11 +748,10 @@ void _ObjectManager::PrintObjectOrientations() {
 // Deletes an object by its ID
 void _ObjectManager::DeleteObjectByID(int ID) {
 
-	for(auto Iterator = Objects.begin(); Iterator != Objects.end(); ++Iterator) {
-		if((*Iterator)->GetID() == ID) {
-			delete (*Iterator);
-			Objects.erase(Iterator);
-			return;
-		}
-	}
+	_Object *Object = GetObjectByID(ID);
+	if(!Object)
+		return;
+
+	RemoveObject(Object);
+	ReleaseObject(Object);
 }
@@ -19,11 +19,17 @@
 
 // Libraries
 #include <string>
-#include <list>
+#include <vector>
+#include <map>
+#include <unordered_map>
 #include <irrTypes.h>
 
 // Forward Declarations
 class _Object;
+struct _ObjectSpawn;
+struct _Template;
+struct _ReplayObjectHash;
+class _PhysicsSnapshot;
 
 // Classes
 class _ObjectManager {
@@ -38,6 +44,11 @@ class _ObjectManager {
 		void Update(float FrameTime);
 		void UpdateReplay(float FrameTime);
 		void UpdateFromReplay();
+		void ApplyReplayOrientations();
+		void WriteKeyframe();
+		void WriteHash();
+		uint32_t GetStateHash(std::vector<_ReplayObjectHash> &ObjectHashes);
+		uint32_t GetBodyStateHash();
 		void InterpolateOrientations(float BlendFactor);
 		void BeginFrame();
 		void EndFrame();
@@ -45,20 +56,56 @@ class _ObjectManager {
 		_Object *AddObject(_Object *Object);
 		void DeleteObject(_Object *Object);
 		void DeleteObjectByID(int ID);
+		void ChangeObjectID(_Object *Object, int ID);
 		_Object *GetObjectByName(const std::string &Name);
 		_Object *GetObjectByType(int Type);
 		_Object *GetObjectByID(int ID);
+		_Object *GetObjectByOrder(uint32_t Order);
+		_Object *GetPooledObject(const _ObjectSpawn &Spawn);
+		_Object *GetResidentObject(const _ObjectSpawn &Spawn);
+		void AddResidentObject(const _ObjectSpawn &Spawn, _Object *Object);
+		void ReserveObjects(size_t Count);
+		void SetPooling(bool Value) { Pooling = Value; }
 
 		void PrintObjectOrientations();
-		void ClearObjects();
+		void ClearObjects(bool KeepResident=false);
+		void Snapshot(_PhysicsSnapshot &Snapshot);
+		bool Restore(_PhysicsSnapshot &Snapshot);
+		void UpdateCollisionHandlers();
 		size_t GetObjectCount() const { return Objects.size(); }
-		const std::list<_Object *> &GetObjects() const { return Objects; }
+		const std::vector<_Object *> &GetObjects() const { return Objects; }
 
 	private:
 
-		std::list<_Object *> Objects;
+		// Objects with the same name or type, ordered by creation
+		typedef std::map<uint32_t, _Object *> _ObjectBucket;
+
+		void AddToIndex(_Object *Object);
+		void RemoveFromIndex(_Object *Object);
+		void RemoveObject(_Object *Object);
+		void ReleaseObject(_Object *Object);
+		void DeleteResidentObject(_Object *Object);
+
+		// Objects in creation order
+		std::vector<_Object *> Objects;
+		uint32_t NextObjectOrder;
 		uint16_t NextObjectID;
 
+		// Incremented when objects are cleared, since creation order starts over
+		uint32_t Generation;
+
+		// Lookup tables, IDs are shared once they wrap so each one lists its holders in creation order
+		std::vector<std::vector<_Object *> > ObjectsByID;
+		std::unordered_map<std::string, _ObjectBucket> ObjectsByName;
+		std::unordered_map<int, _ObjectBucket> ObjectsByType;
+
+		// Recycled objects by template
+		bool Pooling;
+		std::unordered_map<const _Template *, std::vector<_Object *>> ObjectPools;
+
+		// Static level geometry kept across level resets by spawn
+		std::unordered_map<const _ObjectSpawn *, _Object *> ResidentObjects;
+
 };
 
 // Singletons
@@ -52,7 +52,7 @@ _Box::_Box(const _ObjectSpawn &Object) :
 	if(Physics.IsEnabled()) {
 
 		// Create geometry
-		Geometry = dCreateBox(Physics.GetSpace(), Template->Shape[0], Template->Shape[1], Template->Shape[2]);
+		Geometry = dCreateBox(Physics.GetSpace(Template->Mass <= 0), Template->Shape[0], Template->Shape[1], Template->Shape[2]);
 
 		// Create body
 		if(Template->Mass > 0) {
@@ -74,3 +74,12 @@ void _Box::SetShape(const glm::vec3 &Shape) {
 	if(Geometry)
 		dGeomBoxSetLengths(Geometry, Shape.x, Shape.y, Shape.z);
 }
+
+// Restore template shape
+void _Box::ResetShape() {
+	if(Geometry)
+		dGeomBoxSetLengths(Geometry, Template->Shape[0], Template->Shape[1], Template->Shape[2]);
+
+	if(Node)
+		Node->setScale(core::vector3df(Template->Scale[0], Template->Scale[1], Template->Scale[2]));
+}
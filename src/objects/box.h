@@ -31,4 +31,6 @@ class _Box : public _Object {
 
 	private:
 
+		void ResetShape() override;
+
 };
@@ -78,3 +78,23 @@ _Constraint::~_Constraint() {
 	if(Joint)
 		dJointDestroy(Joint);
 }
+
+// Writes the joint state to a snapshot
+void _Constraint::SaveState(_PhysicsSnapshot &Snapshot) const {
+	_Object::SaveState(Snapshot);
+
+	if(Joint)
+		Snapshot.Put((char)dJointIsEnabled(Joint));
+}
+
+// Restores the joint state
+void _Constraint::LoadState(_PhysicsSnapshot &Snapshot) {
+	_Object::LoadState(Snapshot);
+
+	if(Joint) {
+		if(Snapshot.Get<char>())
+			dJointEnable(Joint);
+		else
+			dJointDisable(Joint);
+	}
+}
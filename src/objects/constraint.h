@@ -32,6 +32,9 @@ class _Constraint : public _Object {
 		_Constraint(const _ConstraintSpawn &Constraint);
 		~_Constraint();
 
+		void SaveState(_PhysicsSnapshot &Snapshot) const override;
+		void LoadState(_PhysicsSnapshot &Snapshot) override;
+
 	private:
 
 		// Attributes
@@ -52,7 +52,7 @@ _Cylinder::_Cylinder(const _ObjectSpawn &Object) :
 	if(Physics.IsEnabled()) {
 
 		// Create geometry
-		Geometry = dCreateCylinder(Physics.GetSpace(), Template->Shape[0] / 2, Template->Shape[1]);
+		Geometry = dCreateCylinder(Physics.GetSpace(Template->Mass <= 0), Template->Shape[0] / 2, Template->Shape[1]);
 
 		// Create body
 		if(Template->Mass > 0) {
@@ -74,3 +74,12 @@ void _Cylinder::SetShape(const glm::vec3 &Shape) {
 	if(Geometry)
 		dGeomCylinderSetParams(Geometry, Shape.x / 2, Shape.y);
 }
+
+// Restore template shape
+void _Cylinder::ResetShape() {
+	if(Geometry)
+		dGeomCylinderSetParams(Geometry, Template->Shape[0] / 2, Template->Shape[1]);
+
+	if(Node)
+		Node->setScale(core::vector3df(Template->Scale[0], Template->Scale[1], Template->Scale[2]));
+}
@@ -31,4 +31,6 @@ class _Cylinder : public _Object {
 
 	private:
 
+		void ResetShape() override;
+
 };
@@ -38,7 +38,9 @@ _Object::_Object(const _Template *Template) :
 	Template(Template),
 	Type(NONE),
 	ID(-1),
+	Order(0),
 	Deleted(false),
+	Resident(false),
 	Timer(0.0f),
 	Lifetime(0.0f),
 	Node(nullptr),
@@ -48,6 +50,8 @@ _Object::_Object(const _Template *Template) :
 	Body(nullptr),
 	Geometry(nullptr),
 	NeedsReplayPacket(false),
+	ReplayUpdate(REPLAY_UPDATE_NONE),
+	CollisionHandler(LUA_NOREF),
 	TouchingGroundTimer(0.0f),
 	TouchingGround(false) {
 }
@@ -219,6 +223,213 @@ void _Object::SetProperties(const _ConstraintSpawn &Object) {
 	Lifetime = Template->Lifetime;
 }
 
+// Removes the object from the world so it can be reused
+void _Object::Recycle() {
+
+	// Hide graphics node
+	if(Node)
+		Node->setVisible(false);
+
+	// Detach joints and put the body to sleep
+	if(Body) {
+		while(dBodyGetNumJoints(Body))
+			dJointAttach(dBodyGetJoint(Body, 0), nullptr, nullptr);
+
+		dBodyDisable(Body);
+	}
+
+	// Stop collisions
+	if(Geometry) {
+		dSpaceID Space = dGeomGetSpace(Geometry);
+		if(Space)
+			dSpaceRemove(Space, Geometry);
+	}
+}
+
+// Resets a recycled object to the state of a newly created one
+void _Object::Respawn(const _ObjectSpawn &Object, bool SetTransform) {
+
+	// Reset state
+	Deleted = false;
+	Timer = 0.0f;
+	DrawPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+	NeedsReplayPacket = false;
+	ReplayBase.Reset();
+	ReplayUpdate = REPLAY_UPDATE_NONE;
+	CollisionHandler = LUA_NOREF;
+	TouchingGroundTimer = 0.0f;
+	TouchingGround = false;
+
+	// Restore graphics node
+	if(Node)
+		Node->setVisible(true);
+
+	// Restore shape and add geometry back to the world, geometry without a body is static except for zones
+	ResetShape();
+	if(Geometry)
+		dSpaceAdd(Physics.GetSpace(Body == nullptr && Type != ZONE), Geometry);
+
+	// Restore body to the state set by CreateRigidBody
+	if(Body) {
+		dBodySetAutoDisableDefaults(Body);
+		dBodySetAutoDisableFlag(Body, true);
+		dBodySetAutoDisableAverageSamplesCount(Body, dBodyGetAutoDisableAverageSamplesCount(Body));
+		dBodySetDampingDefaults(Body);
+		dBodySetAngularDampingThreshold(Body, 0);
+		dBodySetLinearDampingThreshold(Body, 0);
+		dBodySetDamping(Body, Template->LinearDamping, Template->AngularDamping);
+		dBodySetForce(Body, 0.0f, 0.0f, 0.0f);
+		dBodySetTorque(Body, 0.0f, 0.0f, 0.0f);
+		SetLinearVelocity(Object.LinearVelocity);
+		SetAngularVelocity(Object.AngularVelocity);
+		if(Template->Sleep)
+			dBodyDisable(Body);
+	}
+
+	SetProperties(Object, SetTransform);
+}
+
+// Writes the state that changes during play to a snapshot
+void _Object::SaveState(_PhysicsSnapshot &Snapshot) const {
+	Snapshot.Put(Timer);
+	Snapshot.Put(Lifetime);
+	Snapshot.Put(TouchingGroundTimer);
+	Snapshot.Put(TouchingGround);
+	Snapshot.Put(LastPosition);
+	Snapshot.Put(LastRotation);
+	Snapshot.Put(DrawPosition);
+
+	// Replay movement
+	Snapshot.Put(NeedsReplayPacket);
+	Snapshot.Put(ReplayBase);
+	Snapshot.Put(ReplayUpdate);
+	Snapshot.Put(ReplayPosition);
+	Snapshot.Put(ReplayRotation);
+	Snapshot.Put(ReplayEulerRotation);
+
+	// Graphics node, which is moved directly by replays
+	if(Node) {
+		const core::vector3df &Position = Node->getPosition();
+		const core::vector3df &Rotation = Node->getRotation();
+		const core::vector3df &Scale = Node->getScale();
+		float Transform[9] = { Position.X, Position.Y, Position.Z, Rotation.X, Rotation.Y, Rotation.Z, Scale.X, Scale.Y, Scale.Z };
+		Snapshot.PutData(Transform, sizeof(Transform));
+	}
+
+	// Rigid body
+	if(Body) {
+		size_t Size = dBodyGetStateSize(Body);
+		Snapshot.Put((uint32_t)Size);
+		dBodyGetState(Body, Snapshot.Allocate(Size));
+	}
+
+	// Geometry that scripts can move or resize
+	if(Geometry) {
+		if(!Body && dGeomGetClass(Geometry) != dPlaneClass) {
+			dVector3 Position;
+			dQuaternion Rotation;
+			dGeomCopyPosition(Geometry, Position);
+			dGeomGetQuaternion(Geometry, Rotation);
+			Snapshot.PutData(Position, sizeof(dReal) * 3);
+			Snapshot.PutData(Rotation, sizeof(dReal) * 4);
+		}
+
+		dVector3 Shape = { 0, 0, 0 };
+		switch(dGeomGetClass(Geometry)) {
+			case dSphereClass:
+				Shape[0] = dGeomSphereGetRadius(Geometry);
+			break;
+			case dBoxClass:
+				dGeomBoxGetLengths(Geometry, Shape);
+			break;
+			case dCylinderClass:
+				dGeomCylinderGetParams(Geometry, &Shape[0], &Shape[1]);
+			break;
+		}
+		Snapshot.PutData(Shape, sizeof(dReal) * 3);
+	}
+}
+
+// Restores state written by SaveState
+void _Object::LoadState(_PhysicsSnapshot &Snapshot) {
+	Deleted = false;
+	Snapshot.Get(Timer);
+	Snapshot.Get(Lifetime);
+	Snapshot.Get(TouchingGroundTimer);
+	Snapshot.Get(TouchingGround);
+	Snapshot.Get(LastPosition);
+	Snapshot.Get(LastRotation);
+	Snapshot.Get(DrawPosition);
+
+	// Replay movement
+	Snapshot.Get(NeedsReplayPacket);
+	Snapshot.Get(ReplayBase);
+	Snapshot.Get(ReplayUpdate);
+	Snapshot.Get(ReplayPosition);
+	Snapshot.Get(ReplayRotation);
+	Snapshot.Get(ReplayEulerRotation);
+
+	// Graphics node, only touched when changed since terrain nodes rebuild their mesh on every move
+	if(Node) {
+		float Transform[9];
+		Snapshot.GetData(Transform, sizeof(Transform));
+		core::vector3df Position(Transform[0], Transform[1], Transform[2]);
+		core::vector3df Rotation(Transform[3], Transform[4], Transform[5]);
+		core::vector3df Scale(Transform[6], Transform[7], Transform[8]);
+		if(Position != Node->getPosition())
+			Node->setPosition(Position);
+		if(Rotation != Node->getRotation())
+			Node->setRotation(Rotation);
+		if(Scale != Node->getScale())
+			Node->setScale(Scale);
+	}
+
+	// Rigid body
+	if(Body) {
+		uint32_t Size = Snapshot.Get<uint32_t>();
+		const void *State = Snapshot.View(Size);
+		if(State && !dBodySetState(Body, State, Size))
+			Log.Write("_Object::LoadState - Body state size mismatch for %s", Name.c_str());
+	}
+
+	// Geometry, only touched when changed since moving it marks it dirty
+	if(Geometry) {
+		if(!Body && dGeomGetClass(Geometry) != dPlaneClass) {
+			dVector3 Position, OldPosition;
+			dQuaternion Rotation, OldRotation;
+			Snapshot.GetData(Position, sizeof(dReal) * 3);
+			Snapshot.GetData(Rotation, sizeof(dReal) * 4);
+			dGeomCopyPosition(Geometry, OldPosition);
+			dGeomGetQuaternion(Geometry, OldRotation);
+			if(std::memcmp(Position, OldPosition, sizeof(dReal) * 3))
+				dGeomSetPosition(Geometry, Position[0], Position[1], Position[2]);
+			if(std::memcmp(Rotation, OldRotation, sizeof(dReal) * 4))
+				dGeomSetQuaternion(Geometry, Rotation);
+		}
+
+		dVector3 Shape;
+		Snapshot.GetData(Shape, sizeof(dReal) * 3);
+		switch(dGeomGetClass(Geometry)) {
+			case dSphereClass:
+				if(Shape[0] != dGeomSphereGetRadius(Geometry))
+					dGeomSphereSetRadius(Geometry, Shape[0]);
+			break;
+			case dBoxClass: {
+				dVector3 Lengths;
+				dGeomBoxGetLengths(Geometry, Lengths);
+				if(std::memcmp(Shape, Lengths, sizeof(dReal) * 3))
+					dGeomBoxSetLengths(Geometry, Shape[0], Shape[1], Shape[2]);
+			} break;
+			case dCylinderClass: {
+				dReal Radius, Length;
+				dGeomCylinderGetParams(Geometry, &Radius, &Length);
+				if(Shape[0] != Radius || Shape[1] != Length)
+					dGeomCylinderSetParams(Geometry, Shape[0], Shape[1]);
+			} break;
+		}
+	}
+}
+
 // Interpolate between last and current orientation
 void _Object::InterpolateOrientation(float BlendFactor) {
 	if(!Node || !Body)
@@ -311,14 +522,21 @@ void _Object::HandleCollision(const _ObjectCollision &ObjectCollision) {
 
 	// Get touching states
 	if(ObjectCollision.OtherObject->GetType() != ZONE) {
-		float NormalY = ObjectCollision.Normal[1] * ObjectCollision.NormalScale;
-		if(NormalY > 0.6f)
+		if(ObjectCollision.MaxNormalY > 0.6f)
 			TouchingGround = true;
 	}
 
 	// Call collision handler
+	if(CollisionHandler != LUA_NOREF)
+		Scripting.CallCollisionHandler(CollisionHandler, this, ObjectCollision.OtherObject);
+}
+
+// Resolves the collision callback name to a Lua function reference
+void _Object::UpdateCollisionHandler() {
 	if(CollisionCallback.size())
-		Scripting.CallCollisionHandler(CollisionCallback, this, ObjectCollision.OtherObject);
+		CollisionHandler = Scripting.GetFunctionReference(CollisionCallback);
+	else
+		CollisionHandler = LUA_NOREF;
 }
 
 // Load a mesh file
@@ -354,6 +572,42 @@ void _Object::EndFrame() {
 	}
 }
 
+// Store replay movement until the next rendered frame
+void _Object::SetReplayOrientation(const glm::vec3 &Position, const glm::quat &Rotation) {
+	ReplayPosition = Position;
+	ReplayRotation = Rotation;
+	ReplayUpdate = REPLAY_UPDATE_QUATERNION;
+}
+
+// Store replay movement from older replays that use euler angles
+void _Object::SetReplayOrientation(const glm::vec3 &Position, const glm::vec3 &EulerRotation) {
+	ReplayPosition = Position;
+	ReplayEulerRotation = EulerRotation;
+	ReplayUpdate = REPLAY_UPDATE_EULER;
+}
+
+// Move the node to the last replay orientation
+void _Object::ApplyReplayOrientation() {
+	if(ReplayUpdate == REPLAY_UPDATE_NONE)
+		return;
+
+	if(ReplayUpdate == REPLAY_UPDATE_QUATERNION)
+		ReplayEulerRotation = Physics.QuaternionToEuler(ReplayRotation);
+	ReplayUpdate = REPLAY_UPDATE_NONE;
+
+	SetPositionFromReplay(core::vector3df(ReplayPosition[0], ReplayPosition[1], ReplayPosition[2]));
+	if(Node)
+		Node->setRotation(core::vector3df(ReplayEulerRotation[0], ReplayEulerRotation[1], ReplayEulerRotation[2]));
+}
+
+// Get the latest replay position, including movement not applied to the node yet
+core::vector3df _Object::GetReplayPosition() {
+	if(ReplayUpdate != REPLAY_UPDATE_NONE)
+		return core::vector3df(ReplayPosition[0], ReplayPosition[1], ReplayPosition[2]);
+
+	return Node ? Node->getPosition() : core::vector3df(0.0f, 0.0f, 0.0f);
+}
+
 // Update the graphic node position
 void _Object::SetPositionFromReplay(const irr::core::vector3df &Position) {
 	if(Node) {
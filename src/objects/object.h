@@ -24,6 +24,7 @@
 #include <string>
 #include <glm/vec3.hpp>
 #include <glm/gtc/quaternion.hpp>
+#include <replay.h>
 
 // Forward Declarations
 class _AudioSource;
@@ -31,6 +32,7 @@ struct _ObjectSpawn;
 struct _ConstraintSpawn;
 struct _Template;
 struct _ObjectCollision;
+class _PhysicsSnapshot;
 
 // Classes
 class _Object {
@@ -68,19 +70,36 @@ class _Object {
 		virtual void UpdateReplay(float FrameTime);
 		bool ReadyForReplayUpdate() const { return NeedsReplayPacket; }
 		void WroteReplayPacket() { NeedsReplayPacket = false; }
+		_ReplayOrientation &GetReplayBase() { return ReplayBase; }
+		void SetReplayOrientation(const glm::vec3 &Position, const glm::quat &Rotation);
+		void SetReplayOrientation(const glm::vec3 &Position, const glm::vec3 &EulerRotation);
+		void ApplyReplayOrientation();
+		irr::core::vector3df GetReplayPosition();
 		virtual void UpdateAudio(const glm::vec3 &Position, float Speed) { }
 
 		// Object properties
 		void SetID(int Value) { ID = Value; }
+		void SetOrder(uint32_t Value) { Order = Value; }
 		void SetDeleted(bool Value) { Deleted = Value; }
+		void SetResident(bool Value) { Resident = Value; }
 		void SetLifetime(float Value) { Lifetime = Timer + Value; }
 		void SetSleep(int State);
 
+		// Pooling and resident level geometry
+		void Recycle();
+		void Respawn(const _ObjectSpawn &Object, bool SetTransform=true);
+
+		// Snapshots
+		virtual void SaveState(_PhysicsSnapshot &Snapshot) const;
+		virtual void LoadState(_PhysicsSnapshot &Snapshot);
+
 		std::string GetName() const { return Name; }
 		bool GetDeleted() const { return Deleted; }
+		bool IsResident() const { return Resident; }
 		float GetLifetime() const { return Lifetime; }
 		int GetType() const { return Type; }
 		const uint16_t &GetID() const { return ID; }
+		uint32_t GetOrder() const { return Order; }
 		const _Template *GetTemplate() const { return Template; }
 
 		// Rigid body
@@ -105,8 +124,10 @@ class _Object {
 
 		irr::scene::ISceneNode *GetNode() { return Node; }
 		dBodyID GetBody() { return Body; }
+		dGeomID GetGeometry() { return Geometry; }
 
 		virtual void HandleCollision(const _ObjectCollision &ObjectCollision);
+		void UpdateCollisionHandler();
 		bool IsTouchingGround() const { return TouchingGroundTimer > 0.0f; }
 
 	protected:
@@ -116,15 +137,18 @@ class _Object {
 		void CreateRigidBody(const _ObjectSpawn &Object, dGeomID Geometry, bool SetTransform=true);
 		void SetProperties(const _ObjectSpawn &Object, bool SetTransform=true);
 		void SetProperties(const _ConstraintSpawn &Object);
+		virtual void ResetShape() { }
 
 		// Attributes
 		std::string Name;
 		const _Template *Template;
 		int Type;
 		uint16_t ID;
+		uint32_t Order;
 
 		// State
 		bool Deleted;
+		bool Resident;
 
 		// Life
 		float Timer, Lifetime;
@@ -139,9 +163,22 @@ class _Object {
 
 		// Replays
 		bool NeedsReplayPacket;
+		_ReplayOrientation ReplayBase;
+
+		// Replay movement waiting to be applied to the node
+		enum ReplayUpdateType {
+			REPLAY_UPDATE_NONE,
+			REPLAY_UPDATE_QUATERNION,
+			REPLAY_UPDATE_EULER,
+		};
+		int ReplayUpdate;
+		glm::vec3 ReplayPosition;
+		glm::quat ReplayRotation;
+		glm::vec3 ReplayEulerRotation;
 
 		// Collision
 		std::string CollisionCallback;
+		int CollisionHandler;
 		float TouchingGroundTimer;
 		bool TouchingGround;
 
@@ -68,14 +68,7 @@ _Orb::_Orb(const _ObjectSpawn &Object) :
 		InnerNode->setMaterialTexture(0, irrDriver->getTexture("textures/orb_glow0.png"));
 
 	// Emit Light
-	if(Config.MultipleLights && Object.Template->EmitLight) {
-		Light = irrScene->addLightSceneNode(0, core::vector3df(Object.Position[0], Object.Position[1], Object.Position[2]), video::SColorf(1.0f, 1.0f, 1.0f), 15.0f);
-
-		video::SLight LightData;
-		LightData.Attenuation.set(0.5f, 0.05f, 0.05f);
-		LightData.CastShadows = false;
-		Light->setLightData(LightData);
-	}
+	CreateLight(Object.Position);
 
 	// Audio
 	Sound = new _AudioSource(Audio.GetBuffer("orb.ogg"), true, 0.0f, 0.40f, 8.0f, 16.0f);
@@ -87,7 +80,7 @@ _Orb::_Orb(const _ObjectSpawn &Object) :
 	if(Physics.IsEnabled()) {
 
 		// Create object
-		Geometry = dCreateSphere(Physics.GetSpace(), Object.Template->Radius);
+		Geometry = dCreateSphere(Physics.GetDynamicSpace(), Object.Template->Radius);
 		CreateRigidBody(Object, Geometry);
 
 		// Set mass
@@ -112,6 +105,19 @@ _Orb::~_Orb() {
 	delete Sound;
 }
 
+// Adds a light at the orb if lights are enabled for it
+void _Orb::CreateLight(const glm::vec3 &Position) {
+	if(Light || !Config.MultipleLights || !Template->EmitLight)
+		return;
+
+	Light = irrScene->addLightSceneNode(0, core::vector3df(Position[0], Position[1], Position[2]), video::SColorf(1.0f, 1.0f, 1.0f), 15.0f);
+
+	video::SLight LightData;
+	LightData.Attenuation.set(0.5f, 0.05f, 0.05f);
+	LightData.CastShadows = false;
+	Light->setLightData(LightData);
+}
+
 // Deactivates the object
 void _Orb::StartDeactivation(const std::string &Callback, float Length) {
 
@@ -122,14 +128,31 @@ void _Orb::StartDeactivation(const std::string &Callback, float Length) {
 
 		// Save the event on the replay
 		if(Replay.IsRecording()) {
-			std::fstream &ReplayFile = Replay.GetFile();
+			_ReplayWriter &ReplayWriter = Replay.GetWriter();
 			Replay.WriteEvent(_Replay::PACKET_ORBDEACTIVATE);
-			ReplayFile.write((char *)&ID, sizeof(ID));
-			ReplayFile.write((char *)&DeactivateLength, sizeof(DeactivateLength));
+			ReplayWriter.Put(ID);
+			ReplayWriter.Put(DeactivateLength);
 		}
 	}
 }
 
+// Restores deactivation state from a replay keyframe
+void _Orb::SetStateFromReplay(int Value, float Time, float Length) {
+	if(Value == ORBSTATE_NORMAL)
+		return;
+
+	State = Value;
+	OrbTime = Time;
+	DeactivateLength = Length;
+
+	// Hide deactivated orbs, the light is removed on the next update
+	if(State == ORBSTATE_DEACTIVATED) {
+		InnerNode->setVisible(false);
+		if(Sound)
+			Sound->SetGain(0.0f);
+	}
+}
+
 // Updates the orb
 void _Orb::Update(float FrameTime) {
 
@@ -210,3 +233,42 @@ void _Orb::SetShape(const glm::vec3 &Shape) {
 	if(Geometry)
 		dGeomSphereSetRadius(Geometry, Shape.x);
 }
+
+// Writes deactivation state to a snapshot
+void _Orb::SaveState(_PhysicsSnapshot &Snapshot) const {
+	_Object::SaveState(Snapshot);
+
+	Snapshot.PutString(DeactivationCallback);
+	Snapshot.Put(State);
+	Snapshot.Put(OrbTime);
+	Snapshot.Put(DeactivateLength);
+}
+
+// Restores deactivation state and the glow, sound and light that show it
+void _Orb::LoadState(_PhysicsSnapshot &Snapshot) {
+	_Object::LoadState(Snapshot);
+
+	DeactivationCallback = Snapshot.GetString();
+	Snapshot.Get(State);
+	Snapshot.Get(OrbTime);
+	Snapshot.Get(DeactivateLength);
+
+	float PercentLeft = 1.0f;
+	if(State == ORBSTATE_DEACTIVATING)
+		PercentLeft = 1.0f - OrbTime / DeactivateLength;
+
+	InnerNode->setVisible(State != ORBSTATE_DEACTIVATED);
+	InnerNode->setSize(core::dimension2df(ORB_GLOWSIZE * PercentLeft, ORB_GLOWSIZE * PercentLeft));
+	if(Sound) {
+		Sound->SetPitch(ORB_PITCH * PercentLeft);
+		Sound->SetGain(State == ORBSTATE_DEACTIVATED ? 0.0f : 1.0f);
+	}
+
+	// Deactivated orbs remove their light on the next update
+	if(State != ORBSTATE_DEACTIVATED) {
+		const core::vector3df &Position = Node->getPosition();
+		CreateLight(glm::vec3(Position.X, Position.Y, Position.Z));
+		if(Light)
+			Light->getLightData().DiffuseColor.set(1.0f, PercentLeft, PercentLeft, PercentLeft);
+	}
+}
@@ -43,11 +43,18 @@ class _Orb : public _Object {
 		void StartDeactivation(const std::string &TCallback, float Length);
 		bool IsStillActive() const { return State == ORBSTATE_NORMAL; }
 		int GetState() const { return State; }
+		float GetOrbTime() const { return OrbTime; }
+		float GetDeactivateLength() const { return DeactivateLength; }
+		void SetStateFromReplay(int Value, float Time, float Length);
 
 		void SetShape(const glm::vec3 &Shape) override;
 
+		void SaveState(_PhysicsSnapshot &Snapshot) const override;
+		void LoadState(_PhysicsSnapshot &Snapshot) override;
+
 	private:
 
+		void CreateLight(const glm::vec3 &Position);
 		void UpdateDeactivation(float FrameTime);
 
 		// Graphics
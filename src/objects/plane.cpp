@@ -53,7 +53,7 @@ _Plane::_Plane(const _ObjectSpawn &Object) :
 	if(Physics.IsEnabled()) {
 
 		// Create geometry
-		Geometry = dCreatePlane(Physics.GetSpace(), Plane[0], Plane[1], Plane[2], Plane[3]);
+		Geometry = dCreatePlane(Physics.GetStaticSpace(), Plane[0], Plane[1], Plane[2], Plane[3]);
 	}
 
 	// Set common properties
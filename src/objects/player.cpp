@@ -83,7 +83,7 @@ _Player::_Player(const _ObjectSpawn &Object) :
 	if(Physics.IsEnabled()) {
 
 		// Create object
-		Geometry = dCreateSphere(Physics.GetSpace(), Object.Template->Radius);
+		Geometry = dCreateSphere(Physics.GetDynamicSpace(), Object.Template->Radius);
 		CreateRigidBody(Object, Geometry);
 
 		// Set mass
@@ -214,3 +214,21 @@ void _Player::SetShape(const glm::vec3 &Shape) {
 	if(Geometry)
 		dGeomSphereSetRadius(Geometry, Shape.x);
 }
+
+// Writes jump state to a snapshot
+void _Player::SaveState(_PhysicsSnapshot &Snapshot) const {
+	_Object::SaveState(Snapshot);
+
+	Snapshot.Put(JumpTimer);
+	Snapshot.Put(JumpCooldown);
+	Snapshot.Put(TorqueFactor);
+}
+
+// Restores jump state
+void _Player::LoadState(_PhysicsSnapshot &Snapshot) {
+	_Object::LoadState(Snapshot);
+
+	Snapshot.Get(JumpTimer);
+	Snapshot.Get(JumpCooldown);
+	Snapshot.Get(TorqueFactor);
+}
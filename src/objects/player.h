@@ -41,6 +41,9 @@ class _Player : public _Object {
 		void SetPositionFromReplay(const irr::core::vector3df &Position);
 		void SetShape(const glm::vec3 &Shape) override;
 
+		void SaveState(_PhysicsSnapshot &Snapshot) const override;
+		void LoadState(_PhysicsSnapshot &Snapshot) override;
+
 	private:
 
 		// Camera
@@ -54,7 +54,7 @@ _Sphere::_Sphere(const _ObjectSpawn &Object) :
 	if(Physics.IsEnabled()) {
 
 		// Create geometry
-		Geometry = dCreateSphere(Physics.GetSpace(), Object.Template->Radius);
+		Geometry = dCreateSphere(Physics.GetSpace(Template->Mass <= 0), Object.Template->Radius);
 
 		// Create body
 		if(Template->Mass > 0) {
@@ -76,3 +76,16 @@ void _Sphere::SetShape(const glm::vec3 &Shape) {
 	if(Geometry)
 		dGeomSphereSetRadius(Geometry, Shape.x);
 }
+
+// Restore template shape
+void _Sphere::ResetShape() {
+	if(Geometry)
+		dGeomSphereSetRadius(Geometry, Template->Radius);
+
+	if(Node) {
+		if(Template->Mesh != "")
+			Node->setScale(core::vector3df(Template->Scale[0], Template->Scale[1], Template->Scale[2]));
+		else
+			Node->setScale(core::vector3df(1.0f, 1.0f, 1.0f));
+	}
+}
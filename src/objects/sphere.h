@@ -31,4 +31,6 @@ class _Sphere : public _Object {
 
 	private:
 
+		void ResetShape() override;
+
 };
@@ -23,6 +23,7 @@ _Template::_Template() {
 
 	// Generic properties
 	TemplateID = -1;
+	SurfaceIndex = -1;
 	Name = "";
 	Type = _Object::NONE;
 	Lifetime = 0.0f;
@@ -31,6 +32,7 @@ _Template::_Template() {
 	CollisionCallback = "";
 	CollisionGroup = _Physics::FILTER_RIGIDBODY | _Physics::FILTER_CAMERA;
 	CollisionMask = _Physics::FILTER_RIGIDBODY | _Physics::FILTER_STATIC;
+	MaxContacts = 0;
 
 	// Physical properties
 	Kinematic = 0;
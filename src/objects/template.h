@@ -29,6 +29,7 @@ struct _Template {
 
 	// Generic properties
 	int16_t TemplateID;
+	int SurfaceIndex;
 	std::string Name;
 	int Type;
 	float Lifetime;
@@ -37,6 +38,7 @@ struct _Template {
 	std::string CollisionCallback;
 	int CollisionGroup;
 	int CollisionMask;
+	int MaxContacts;
 
 	// Physical properties
 	std::string CollisionFile;
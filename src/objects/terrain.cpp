@@ -20,18 +20,21 @@
 #include <physics.h>
 #include <config.h>
 #include <level.h>
-#include <save.h>
 #include <objects/template.h>
 #include <ITerrainSceneNode.h>
 #include <CDynamicMeshBuffer.h>
 #include <ISceneManager.h>
+#include <algorithm>
 #include <fstream>
+#include <cmath>
+#include <vector>
 
 using namespace irr;
 
 // Constructor
 _Terrain::_Terrain(const _ObjectSpawn &Object) :
 	_Object(Object.Template),
+	HeightfieldData(nullptr),
 	TriMeshData(nullptr),
 	VertexList(nullptr),
 	FaceList(nullptr) {
@@ -71,49 +74,12 @@ _Terrain::_Terrain(const _ObjectSpawn &Object) :
 		if(Template->CustomMaterial != -1)
 			Terrain->setMaterialType((video::E_MATERIAL_TYPE)Template->CustomMaterial);
 
+		// Create collision geometry
 		if(Physics.IsEnabled()) {
-
-			// Get vertex data
-			scene::CDynamicMeshBuffer MeshBuffer(video::EVT_STANDARD, video::EIT_32BIT);
-			Terrain->getMeshBufferForLOD(MeshBuffer, 0);
-			uint16_t *Indices = MeshBuffer.getIndices();
-
-			// Allocate memory for lists
-			int VertexCount = MeshBuffer.getIndexCount() * 3;
-			int IndexCount = MeshBuffer.getIndexCount();
-			VertexList = new float[VertexCount];
-			FaceList = new dTriIndex[IndexCount];
-
-			// Transform vertices
-			core::matrix4 RotationTransform;
-			RotationTransform.setRotationDegrees(Terrain->getRotation());
-			video::S3DVertex *Vertices = (video::S3DVertex *)MeshBuffer.getVertices();
-
-			// Get face and vertex list
-			int VertexIndex = 0;
-			for(int i = 0; i < IndexCount; i += 3) {
-				FaceList[i+0] = i+0;
-				FaceList[i+1] = i+1;
-				FaceList[i+2] = i+2;
-				for(int j = 0; j < 3; j++) {
-
-					// Apply terrain transform
-					core::vector3df Vertex = Vertices[Indices[i+j]].Pos * Terrain->getScale() + Terrain->getPosition();
-					Vertex -= OriginalRotationPivot;
-					RotationTransform.inverseRotateVect(Vertex);
-					Vertex += OriginalRotationPivot;
-
-					// Set triangle
-					VertexList[VertexIndex++] = Vertex.X;
-					VertexList[VertexIndex++] = Vertex.Y;
-					VertexList[VertexIndex++] = Vertex.Z;
-				}
-			}
-
-			// Create trimesh
-			TriMeshData = dGeomTriMeshDataCreate();
-			dGeomTriMeshDataBuildSingle1(TriMeshData, VertexList, 3 * sizeof(float), VertexCount / 3, FaceList, IndexCount, 3 * sizeof(dTriIndex), nullptr);
-			Geometry = dCreateTriMesh(Physics.GetSpace(), TriMeshData, 0, 0, 0);
+			if(Physics.HasHeightfieldTerrain())
+				CreateHeightfield(Terrain, OriginalRotationPivot);
+			else
+				CreateTrimesh(Terrain, OriginalRotationPivot);
 		}
 
 		SetProperties(Object, false);
@@ -122,12 +88,110 @@ _Terrain::_Terrain(const _ObjectSpawn &Object) :
 
 // Destructor
 _Terrain::~_Terrain() {
-	dGeomTriMeshDataDestroy(TriMeshData);
+	if(HeightfieldData)
+		dGeomHeightfieldDataDestroy(HeightfieldData);
+	if(TriMeshData)
+		dGeomTriMeshDataDestroy(TriMeshData);
 	delete[] VertexList;
 	delete[] FaceList;
 }
 
-// Get path to terrain cache file
-std::string _Terrain::GetCachePath(const std::string &ObjectName) {
-	return Save.CachePath + Level.LevelName + "_" + std::to_string(Level.LevelVersion) + "_" + ObjectName + ".cache";
+// Create a heightfield from the LOD 0 terrain heights
+void _Terrain::CreateHeightfield(scene::ITerrainSceneNode *Terrain, const core::vector3df &RotationPivot) {
+
+	// Get vertex data
+	scene::CDynamicMeshBuffer MeshBuffer(video::EVT_STANDARD, video::EIT_32BIT);
+	Terrain->getMeshBufferForLOD(MeshBuffer, 0);
+	video::S3DVertex *Vertices = (video::S3DVertex *)MeshBuffer.getVertices();
+	const scene::IIndexBuffer &Indices = MeshBuffer.getIndexBuffer();
+
+	// Vertices are stored in rows of X, patches may not cover the whole heightmap
+	int Size = (int)std::lround(std::sqrt((double)MeshBuffer.getVertexCount()));
+	uint32_t MaxIndex = 0;
+	for(uint32_t i = 0; i < Indices.size(); i++)
+		MaxIndex = std::max(MaxIndex, Indices[i]);
+	int CountX = (int)MaxIndex / Size + 1;
+	int CountZ = (int)MaxIndex % Size + 1;
+
+	// Heightfields split cells along the other diagonal, so sample width runs along -Z and depth along X
+	core::vector3df Scale = Terrain->getScale();
+	std::vector<float> Heights(CountX * CountZ);
+	float MinHeight = Vertices[0].Pos.Y * Scale.Y;
+	float MaxHeight = MinHeight;
+	for(int x = 0; x < CountX; x++) {
+		for(int z = 0; z < CountZ; z++) {
+			float Height = Vertices[x * Size + z].Pos.Y * Scale.Y;
+			Heights[(CountZ - 1 - z) + x * CountZ] = Height;
+			MinHeight = std::min(MinHeight, Height);
+			MaxHeight = std::max(MaxHeight, Height);
+		}
+	}
+
+	// Create heightfield
+	float Width = (CountZ - 1) * Scale.Z;
+	float Depth = (CountX - 1) * Scale.X;
+	HeightfieldData = dGeomHeightfieldDataCreate();
+	dGeomHeightfieldDataBuildSingle(HeightfieldData, &Heights[0], 1, Width, Depth, CountZ, CountX, 1.0f, 0.0f, 1.0f, 0);
+	dGeomHeightfieldDataSetBounds(HeightfieldData, MinHeight, MaxHeight);
+	Geometry = dCreateHeightfield(Physics.GetStaticSpace(), HeightfieldData, 1);
+
+	// Rotate the heightfield about the original pivot like the trimesh vertices
+	core::matrix4 RotationTransform;
+	RotationTransform.setRotationDegrees(Terrain->getRotation());
+	core::vector3df Position = core::vector3df(Depth / 2, 0.0f, Width / 2) + Terrain->getPosition() - RotationPivot;
+	RotationTransform.inverseRotateVect(Position);
+	Position += RotationPivot;
+	dGeomSetPosition(Geometry, Position.X, Position.Y, Position.Z);
+
+	// Heightfield axes in terrain space
+	core::vector3df Axes[3] = { core::vector3df(0, 0, -1), core::vector3df(0, 1, 0), core::vector3df(1, 0, 0) };
+	dMatrix3 Rotation = { 0 };
+	for(int i = 0; i < 3; i++) {
+		RotationTransform.inverseRotateVect(Axes[i]);
+		Rotation[0 * 4 + i] = Axes[i].X;
+		Rotation[1 * 4 + i] = Axes[i].Y;
+		Rotation[2 * 4 + i] = Axes[i].Z;
+	}
+	dGeomSetRotation(Geometry, Rotation);
+}
+
+// Create an indexed trimesh from the LOD 0 terrain mesh
+void _Terrain::CreateTrimesh(scene::ITerrainSceneNode *Terrain, const core::vector3df &RotationPivot) {
+
+	// Get vertex data
+	scene::CDynamicMeshBuffer MeshBuffer(video::EVT_STANDARD, video::EIT_32BIT);
+	Terrain->getMeshBufferForLOD(MeshBuffer, 0);
+	const scene::IIndexBuffer &Indices = MeshBuffer.getIndexBuffer();
+
+	// Allocate memory for lists
+	int VertexCount = MeshBuffer.getVertexCount();
+	int IndexCount = Indices.size();
+	VertexList = new float[VertexCount * 3];
+	FaceList = new dTriIndex[IndexCount];
+
+	// Transform vertices
+	core::matrix4 RotationTransform;
+	RotationTransform.setRotationDegrees(Terrain->getRotation());
+	video::S3DVertex *Vertices = (video::S3DVertex *)MeshBuffer.getVertices();
+	for(int i = 0; i < VertexCount; i++) {
+
+		// Apply terrain transform
+		core::vector3df Vertex = Vertices[i].Pos * Terrain->getScale() + Terrain->getPosition();
+		Vertex -= RotationPivot;
+		RotationTransform.inverseRotateVect(Vertex);
+		Vertex += RotationPivot;
+
+		VertexList[i * 3 + 0] = Vertex.X;
+		VertexList[i * 3 + 1] = Vertex.Y;
+		VertexList[i * 3 + 2] = Vertex.Z;
+	}
+
+	// Get face list
+	for(int i = 0; i < IndexCount; i++)
+		FaceList[i] = Indices[i];
+
+	// Create trimesh
+	TriMeshData = dGeomTriMeshDataCreate();
+	dGeomTriMeshDataBuildSingle1(TriMeshData, VertexList, 3 * sizeof(float), VertexCount, FaceList, IndexCount, 3 * sizeof(dTriIndex), nullptr);
+	Geometry = dCreateTriMesh(Physics.GetStaticSpace(), TriMeshData, 0, 0, 0);
 }
@@ -19,7 +19,9 @@
 
 // Libraries
 #include <objects/object.h>
+#include <ode/collision.h>
 #include <ode/collision_trimesh.h>
+#include <ITerrainSceneNode.h>
 
 // Classes
 class _Terrain : public _Object {
@@ -31,8 +33,10 @@ class _Terrain : public _Object {
 
 	private:
 
-		std::string GetCachePath(const std::string &ObjectName);
+		void CreateHeightfield(irr::scene::ITerrainSceneNode *Terrain, const irr::core::vector3df &RotationPivot);
+		void CreateTrimesh(irr::scene::ITerrainSceneNode *Terrain, const irr::core::vector3df &RotationPivot);
 
+		dHeightfieldDataID HeightfieldData;
 		dTriMeshDataID TriMeshData;
 		float *VertexList;
 		dTriIndex *FaceList;
@@ -18,77 +18,327 @@
 #include <objects/trimesh.h>
 #include <physics.h>
 #include <globals.h>
+#include <level.h>
+#include <log.h>
+#include <colfile.h>
 #include <objects/template.h>
 #include <ode/collision.h>
 #include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+	#include <process.h>
+	#define getpid _getpid
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+// Colmesh writes COLFILE_INDEX_SIZE indices so they can be referenced without a copy
+static_assert(sizeof(dTriIndex) == COLFILE_INDEX_SIZE, "COLFILE_INDEX_SIZE should match ODE's dTriIndex");
+
+// Cache file header, followed by the serialized collision tree
+struct _TrimeshCacheHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t FileHash;
+	uint32_t FileSize;
+	int32_t LevelVersion;
+	uint32_t VertexCount;
+	uint32_t FaceCount;
+	uint32_t Padding;
+	uint64_t TreeSize;
+};
+
+const uint32_t TRIMESH_CACHE_MAGIC = 0x4d435254;
+const uint32_t TRIMESH_CACHE_VERSION = 2;
+
+// FNV-1a hash of a collision file
+static uint32_t HashFile(const char *Data, size_t Size) {
+	uint32_t Hash = 2166136261u;
+	for(size_t i = 0; i < Size; i++) {
+		Hash ^= (uint8_t)Data[i];
+		Hash *= 16777619u;
+	}
+
+	return Hash;
+}
 
 // Constructor
 _Trimesh::_Trimesh(const _ObjectSpawn &Object) :
 	_Object(Object.Template),
 	TriMeshData(nullptr),
+	Mapping(nullptr),
+	MappingSize(0),
+	MeshData(nullptr),
 	VertexList(nullptr),
-	FaceList(nullptr) {
+	FaceList(nullptr),
+	VertexCount(0),
+	FaceCount(0) {
 
 	// Load collision mesh file
-	std::ifstream MeshFile(Object.Template->CollisionFile.c_str(), std::ios::binary);
-	if(MeshFile) {
-
-		// Read header
-		int VertexCount, FaceCount;
-		MeshFile.read((char *)&VertexCount, sizeof(VertexCount));
-		MeshFile.read((char *)&FaceCount, sizeof(FaceCount));
-
-		// Allocate memory for lists
-		VertexList = new float[VertexCount * 3];
-		FaceList = new dTriIndex[FaceCount * 3];
-
-		// Read vertices
-		int VertexIndex = 0;
-		for(int i = 0; i < VertexCount; i++) {
-			float Value;
-			MeshFile.read((char *)&Value, sizeof(Value));
-			VertexList[VertexIndex++] = Value;
-
-			MeshFile.read((char *)&Value, sizeof(Value));
-			VertexList[VertexIndex++] = Value;
-
-			MeshFile.read((char *)&Value, sizeof(Value));
-			VertexList[VertexIndex++] = -Value;
+	const std::string &CollisionFile = Object.Template->CollisionFile;
+	if(MapFile(CollisionFile) && GetMeshLists()) {
+
+		// Use the cached tree when the file hasn't changed, otherwise build and cache it
+		uint32_t FileHash = HashFile(Mapping, MappingSize);
+		std::string CachePath = Level.GetCachePath(CollisionFile.substr(CollisionFile.find_last_of("/\\") + 1));
+		TriMeshData = dGeomTriMeshDataCreate();
+		if(!LoadCache(CachePath, FileHash)) {
+			dGeomTriMeshDataBuildSingle1(TriMeshData, VertexList, 3 * sizeof(float), VertexCount, FaceList, FaceCount * 3, 3 * sizeof(dTriIndex), nullptr);
+			SaveCache(CachePath, FileHash);
 		}
 
-		// Read faces
-		int FaceIndex = 0;
-		for(int i = 0; i < FaceCount; i++) {
-			int Value;
+		Geometry = dCreateTriMesh(Physics.GetStaticSpace(), TriMeshData, 0, 0, 0);
+	}
+
+	SetProperties(Object, false);
+}
+
+// Destructor
+_Trimesh::~_Trimesh() {
+
+	if(TriMeshData)
+		dGeomTriMeshDataDestroy(TriMeshData);
+	delete[] MeshData;
+	UnmapFile();
+}
 
-			MeshFile.read((char *)&Value, sizeof(Value));
-			FaceList[FaceIndex+2] = Value;
+// Maps a collision file into memory, ODE references the mapping directly for version 2 files
+bool _Trimesh::MapFile(const std::string &Path) {
 
-			MeshFile.read((char *)&Value, sizeof(Value));
-			FaceList[FaceIndex+1] = Value;
+	#ifdef _WIN32
 
-			MeshFile.read((char *)&Value, sizeof(Value));
-			FaceList[FaceIndex+0] = Value;
+		// Read the file into memory
+		std::ifstream File(Path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+		if(!File)
+			return false;
 
-			FaceIndex += 3;
+		MappingSize = (size_t)File.tellg();
+		Mapping = new char[MappingSize ? MappingSize : 1];
+		File.seekg(0);
+		File.read(Mapping, (std::streamsize)MappingSize);
+		if(!File) {
+			UnmapFile();
+			return false;
 		}
+	#else
+		int FileDescriptor = open(Path.c_str(), O_RDONLY);
+		if(FileDescriptor == -1)
+			return false;
 
-		// Close file
-		MeshFile.close();
+		// Map file, empty files have nothing to map
+		struct stat FileStat;
+		if(fstat(FileDescriptor, &FileStat) == 0 && FileStat.st_size > 0) {
+			void *Address = mmap(nullptr, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+			if(Address != MAP_FAILED) {
+				Mapping = (char *)Address;
+				MappingSize = (size_t)FileStat.st_size;
+			}
+		}
+		close(FileDescriptor);
 
-		// Create trimesh
-		TriMeshData = dGeomTriMeshDataCreate();
-		dGeomTriMeshDataBuildSingle1(TriMeshData, VertexList, 3 * sizeof(float), VertexCount, FaceList, FaceIndex, 3 * sizeof(dTriIndex), nullptr);
-		Geometry = dCreateTriMesh(Physics.GetSpace(), TriMeshData, 0, 0, 0);
+		if(!Mapping)
+			return false;
+	#endif
+
+	return true;
+}
+
+// Unmaps the collision file
+void _Trimesh::UnmapFile() {
+	if(Mapping) {
+		#ifdef _WIN32
+			delete[] Mapping;
+		#else
+			munmap(Mapping, MappingSize);
+		#endif
 	}
 
-	SetProperties(Object, false);
+	Mapping = nullptr;
+	MappingSize = 0;
 }
 
-// Destructor
-_Trimesh::~_Trimesh() {
+// Check that every face index of a version 2 file refers to a vertex
+static bool CheckIndices(const char *Data, uint32_t IndexSize, int IndexCount, uint32_t VertexCount) {
+	for(int i = 0; i < IndexCount; i++) {
+		uint32_t Index = IndexSize == 2 ? ((const uint16_t *)Data)[i] : ((const uint32_t *)Data)[i];
+		if(Index >= VertexCount)
+			return false;
+	}
+
+	return true;
+}
+
+// Get vertex and face lists in ODE layout, converting version 1 files and indices that don't match dTriIndex
+bool _Trimesh::GetMeshLists() {
+	if(MappingSize < 2 * sizeof(int)) {
+		Log.Write("_Trimesh::GetMeshLists - Bad collision file");
+		return false;
+	}
+
+	// Version 2
+	uint32_t Magic;
+	memcpy(&Magic, Mapping, sizeof(Magic));
+	if(Magic == COLFILE_MAGIC) {
+		const _ColHeader *Header = (const _ColHeader *)Mapping;
+		if(MappingSize < sizeof(_ColHeader)
+			|| Header->Version != COLFILE_VERSION
+			|| (Header->IndexSize != 2 && Header->IndexSize != 4)
+			|| Header->VertexOffset % COLFILE_ALIGNMENT || Header->IndexOffset % COLFILE_ALIGNMENT
+			|| Header->VertexOffset > MappingSize || (MappingSize - Header->VertexOffset) / (3 * sizeof(float)) < Header->VertexCount
+			|| Header->IndexOffset > MappingSize || (MappingSize - Header->IndexOffset) / (3 * Header->IndexSize) < Header->FaceCount) {
+			Log.Write("_Trimesh::GetMeshLists - Bad version 2 collision file");
+			return false;
+		}
+
+		// Check indices once so ODE never reads past the vertex list
+		if(!CheckIndices(Mapping + Header->IndexOffset, Header->IndexSize, (int)Header->FaceCount * 3, Header->VertexCount)) {
+			Log.Write("_Trimesh::GetMeshLists - Bad face index in collision file");
+			return false;
+		}
+
+		VertexCount = (int)Header->VertexCount;
+		FaceCount = (int)Header->FaceCount;
+		VertexList = (const float *)(Mapping + Header->VertexOffset);
+
+		// Reference indices directly when they match dTriIndex
+		if(Header->IndexSize == sizeof(dTriIndex)) {
+			FaceList = (const dTriIndex *)(Mapping + Header->IndexOffset);
+		}
+		else {
+			dTriIndex *Indices = new dTriIndex[FaceCount * 3];
+			if(Header->IndexSize == 2) {
+				const uint16_t *Source = (const uint16_t *)(Mapping + Header->IndexOffset);
+				for(int i = 0; i < FaceCount * 3; i++)
+					Indices[i] = Source[i];
+			}
+			else {
+				const uint32_t *Source = (const uint32_t *)(Mapping + Header->IndexOffset);
+				for(int i = 0; i < FaceCount * 3; i++)
+					Indices[i] = (dTriIndex)Source[i];
+			}
+
+			MeshData = (char *)Indices;
+			FaceList = Indices;
+		}
+
+		return true;
+	}
+
+	// Version 1 header
+	memcpy(&VertexCount, Mapping, sizeof(VertexCount));
+	memcpy(&FaceCount, Mapping + sizeof(int), sizeof(FaceCount));
+	if(VertexCount < 0 || FaceCount < 0 || (MappingSize - 2 * sizeof(int)) / (3 * sizeof(int)) < (size_t)VertexCount + (size_t)FaceCount) {
+		Log.Write("_Trimesh::GetMeshLists - Bad collision file");
+		return false;
+	}
+
+	// Allocate memory for lists
+	size_t VertexSize = (size_t)VertexCount * 3 * sizeof(float);
+	MeshData = new char[VertexSize + (size_t)FaceCount * 3 * sizeof(dTriIndex)];
+	float *Vertices = (float *)MeshData;
+	dTriIndex *Faces = (dTriIndex *)(MeshData + VertexSize);
+
+	// Read vertices
+	const char *Source = Mapping + 2 * sizeof(int);
+	memcpy(Vertices, Source, VertexSize);
+	for(int i = 0; i < VertexCount; i++)
+		Vertices[i * 3 + 2] = -Vertices[i * 3 + 2];
+	Source += VertexSize;
+
+	// Read faces
+	int FaceIndex = 0;
+	for(int i = 0; i < FaceCount; i++) {
+		int Values[3];
+		memcpy(Values, Source, sizeof(Values));
+		Source += sizeof(Values);
+		for(int j = 0; j < 3; j++) {
+			if(Values[j] < 0 || Values[j] >= VertexCount) {
+				Log.Write("_Trimesh::GetMeshLists - Bad face index in collision file");
+				return false;
+			}
+		}
+
+		Faces[FaceIndex+2] = Values[0];
+		Faces[FaceIndex+1] = Values[1];
+		Faces[FaceIndex+0] = Values[2];
+
+		FaceIndex += 3;
+	}
+
+	VertexList = Vertices;
+	FaceList = Faces;
+
+	return true;
+}
+
+// Restore the collision tree from a cache file
+bool _Trimesh::LoadCache(const std::string &Path, uint32_t FileHash) {
+	std::ifstream CacheFile(Path.c_str(), std::ios::binary | std::ios::ate);
+	if(!CacheFile)
+		return false;
+
+	size_t Size = (size_t)CacheFile.tellg();
+	if(Size < sizeof(_TrimeshCacheHeader))
+		return false;
+
+	std::vector<uint64_t> Data((Size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+	CacheFile.seekg(0);
+	CacheFile.read((char *)Data.data(), (std::streamsize)Size);
+
+	// Check that the cache belongs to this file and build
+	const _TrimeshCacheHeader *Header = (const _TrimeshCacheHeader *)Data.data();
+	if(!CacheFile
+		|| Header->Magic != TRIMESH_CACHE_MAGIC
+		|| Header->Version != TRIMESH_CACHE_VERSION
+		|| Header->FileHash != FileHash
+		|| Header->FileSize != MappingSize
+		|| Header->LevelVersion != Level.LevelVersion
+		|| Header->VertexCount != (uint32_t)VertexCount
+		|| Header->FaceCount != (uint32_t)FaceCount
+		|| Header->TreeSize != Size - sizeof(_TrimeshCacheHeader))
+		return false;
+
+	if(!dGeomTriMeshDataBuildSingleFromTree(TriMeshData, VertexList, 3 * sizeof(float), VertexCount, FaceList, FaceCount * 3, 3 * sizeof(dTriIndex), Header + 1, Header->TreeSize)) {
+		Log.Write("_Trimesh::LoadCache - Rejected collision tree in %s", Path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+// Write the collision tree to a cache file, other processes only ever see a complete file
+void _Trimesh::SaveCache(const std::string &Path, uint32_t FileHash) {
+	_TrimeshCacheHeader Header;
+	Header.Magic = TRIMESH_CACHE_MAGIC;
+	Header.Version = TRIMESH_CACHE_VERSION;
+	Header.FileHash = FileHash;
+	Header.FileSize = (uint32_t)MappingSize;
+	Header.LevelVersion = Level.LevelVersion;
+	Header.VertexCount = (uint32_t)VertexCount;
+	Header.FaceCount = (uint32_t)FaceCount;
+	Header.Padding = 0;
+	Header.TreeSize = dGeomTriMeshDataGetTreeSize(TriMeshData);
+
+	std::vector<char> Tree((size_t)Header.TreeSize);
+	dGeomTriMeshDataGetTree(TriMeshData, Tree.data());
+
+	// Write to a temporary file named per process, since -validate-dir children share the cache
+	std::string TempPath = Path + "." + std::to_string(getpid()) + ".tmp";
+	std::ofstream CacheFile(TempPath.c_str(), std::ios::binary | std::ios::trunc);
+	if(!CacheFile)
+		return;
+
+	CacheFile.write((const char *)&Header, sizeof(Header));
+	CacheFile.write(Tree.data(), (std::streamsize)Tree.size());
+	CacheFile.close();
 
-	dGeomTriMeshDataDestroy(TriMeshData);
-	delete[] VertexList;
-	delete[] FaceList;
+	if(!CacheFile || rename(TempPath.c_str(), Path.c_str()) != 0)
+		remove(TempPath.c_str());
 }
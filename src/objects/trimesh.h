@@ -20,6 +20,8 @@
 // Libraries
 #include <objects/object.h>
 #include <ode/collision_trimesh.h>
+#include <cstdint>
+#include <string>
 
 // Classes
 class _Trimesh : public _Object {
@@ -31,8 +33,19 @@ class _Trimesh : public _Object {
 
 	protected:
 
+		bool MapFile(const std::string &Path);
+		void UnmapFile();
+		bool GetMeshLists();
+		bool LoadCache(const std::string &Path, uint32_t FileHash);
+		void SaveCache(const std::string &Path, uint32_t FileHash);
+
 		dTriMeshDataID TriMeshData;
-		float *VertexList;
-		dTriIndex *FaceList;
+		char *Mapping;
+		size_t MappingSize;
+		char *MeshData;
+		const float *VertexList;
+		const dTriIndex *FaceList;
+		int VertexCount;
+		int FaceCount;
 
 };
@@ -19,6 +19,7 @@
 #include <globals.h>
 #include <physics.h>
 #include <scripting.h>
+#include <objectmanager.h>
 #include <objects/template.h>
 #include <ode/collision.h>
 
@@ -31,8 +32,8 @@ _Zone::_Zone(const _ObjectSpawn &Object) :
 	// Set up physics
 	if(Physics.IsEnabled()) {
 
-		// Create geometry
-		Geometry = dCreateBox(Physics.GetSpace(), Template->Shape[0], Template->Shape[1], Template->Shape[2]);
+		// Create geometry, zones stay in the dynamic space so they see every object
+		Geometry = dCreateBox(Physics.GetDynamicSpace(), Template->Shape[0], Template->Shape[1], Template->Shape[2]);
 	}
 
 	// Set common properties
@@ -60,8 +61,8 @@ void _Zone::HandleCollision(const _ObjectCollision &ObjectCollision) {
 		TouchState.push_back(ObjectTouchState(ObjectCollision.OtherObject, 2));
 
 		// Call Lua function
-		if(CollisionCallback.size())
-			Scripting.CallZoneHandler(CollisionCallback, 0, this, ObjectCollision.OtherObject);
+		if(CollisionHandler != LUA_NOREF)
+			Scripting.CallZoneHandler(CollisionHandler, 0, this, ObjectCollision.OtherObject);
 	}
 }
 
@@ -76,8 +77,8 @@ void _Zone::EndFrame() {
 			if(Iterator->TouchCount <= 0) {
 
 				// Call Lua function
-				if(CollisionCallback.size())
-					Scripting.CallZoneHandler(CollisionCallback, 1, this, Iterator->Object);
+				if(CollisionHandler != LUA_NOREF)
+					Scripting.CallZoneHandler(CollisionHandler, 1, this, Iterator->Object);
 
 				Iterator = TouchState.erase(Iterator);
 			}
@@ -99,3 +100,30 @@ void _Zone::SetShape(const glm::vec3 &Shape) {
 	if(Geometry)
 		dGeomBoxSetLengths(Geometry, Shape.x, Shape.y, Shape.z);
 }
+
+// Writes the active state and touching objects to a snapshot
+void _Zone::SaveState(_PhysicsSnapshot &Snapshot) const {
+	_Object::SaveState(Snapshot);
+
+	Snapshot.Put(Active);
+	Snapshot.Put((uint32_t)TouchState.size());
+	for(auto &Iterator : TouchState) {
+		Snapshot.Put(Iterator.Object->GetOrder());
+		Snapshot.Put(Iterator.TouchCount);
+	}
+}
+
+// Restores the active state and touching objects
+void _Zone::LoadState(_PhysicsSnapshot &Snapshot) {
+	_Object::LoadState(Snapshot);
+
+	Snapshot.Get(Active);
+	TouchState.clear();
+	uint32_t Count = Snapshot.Get<uint32_t>();
+	for(uint32_t i = 0; i < Count && !Snapshot.IsOverrun(); i++) {
+		_Object *Object = ObjectManager.GetObjectByOrder(Snapshot.Get<uint32_t>());
+		int TouchCount = Snapshot.Get<int>();
+		if(Object)
+			TouchState.push_back(ObjectTouchState(Object, TouchCount));
+	}
+}
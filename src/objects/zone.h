@@ -43,6 +43,9 @@ class _Zone : public _Object {
 		void SetActive(bool Value);
 		void SetShape(const glm::vec3 &Shape) override;
 
+		void SaveState(_PhysicsSnapshot &Snapshot) const override;
+		void LoadState(_PhysicsSnapshot &Snapshot) override;
+
 	private:
 
 		// Attributes
@@ -405,6 +405,19 @@ ODE_API void dGeomDisable (dGeomID geom);
 ODE_API int dGeomIsEnabled (dGeomID geom);
 
 
+/**
+ * @brief Check to see if a geom has moved since its space was last cleaned.
+ *
+ * Dirty geoms sit at the front of their space and have their AABBs
+ * recomputed by the next collision pass.
+ *
+ * @param geom   the geom to query
+ * @returns Non-zero if the geom is dirty, zero otherwise.
+ * @ingroup collide
+ */
+ODE_API int dGeomIsDirty (dGeomID geom);
+
+
 enum
 {
 	dGeomCommonControlClass = 0,
@@ -126,6 +126,18 @@ ODE_API void dGeomTriMeshDataBuildSingle1(dTriMeshDataID g,
                                   const void* Indices, int IndexCount, int TriStride,
                                   const void* Normals);
 /*
+* Saves and restores the OPCODE tree built for single precision data so it can be
+* cached between runs. dGeomTriMeshDataGetTree copies dGeomTriMeshDataGetTreeSize
+* bytes into Tree. dGeomTriMeshDataBuildSingleFromTree must be given the same
+* vertices and indices the tree was built from and returns 0 if the tree is rejected.
+*/
+ODE_API size_t dGeomTriMeshDataGetTreeSize(dTriMeshDataID g);
+ODE_API void dGeomTriMeshDataGetTree(dTriMeshDataID g, void* Tree);
+ODE_API int dGeomTriMeshDataBuildSingleFromTree(dTriMeshDataID g,
+                                  const void* Vertices, int VertexStride, int VertexCount, 
+                                  const void* Indices, int IndexCount, int TriStride,
+                                  const void* Tree, size_t TreeSize);
+/*
 * Build a TriMesh data object with double precision vertex data.
 */
 ODE_API void dGeomTriMeshDataBuildDouble(dTriMeshDataID g, 
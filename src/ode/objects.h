@@ -1141,6 +1141,33 @@ ODE_API void dBodySetForce  (dBodyID b, dReal x, dReal y, dReal z);
  */
 ODE_API void dBodySetTorque (dBodyID b, dReal x, dReal y, dReal z);
 
+/**
+ * @brief Get the size of the buffer needed by dBodyGetState.
+ * @ingroup bodies
+ */
+ODE_API size_t dBodyGetStateSize (dBodyID b);
+
+/**
+ * @brief Copy the dynamic state of a body into a buffer.
+ * @remarks
+ * The state holds the flags, position, rotation, velocities, force and torque
+ * accumulators and the auto-disable counters and average buffers, so a body
+ * restored with dBodySetState steps exactly as it did from the saved state.
+ * Parameters such as mass and damping are not included.
+ * @ingroup bodies
+ * @param data buffer of at least dBodyGetStateSize bytes
+ */
+ODE_API void dBodyGetState (dBodyID b, void *data);
+
+/**
+ * @brief Restore the dynamic state of a body saved by dBodyGetState.
+ * @remarks
+ * Attached geoms are marked as moved.
+ * @ingroup bodies
+ * @return 0 if size doesn't match the state size of the body.
+ */
+ODE_API int dBodySetState (dBodyID b, const void *data, size_t size);
+
 /**
  * @brief Get world position of a relative point on body.
  * @ingroup bodies
@@ -781,6 +781,12 @@ int dGeomIsEnabled (dxGeom *g)
     return (g->gflags & GEOM_ENABLED) != 0;
 }
 
+int dGeomIsDirty (dxGeom *g)
+{
+    dAASSERT (g);
+    return (g->gflags & GEOM_DIRTY) != 0;
+}
+
 
 void dGeomGetRelPointPos (dGeomID g, dReal px, dReal py, dReal pz, dVector3 result)
 {
@@ -33,9 +33,18 @@
 #include "collision_space_internal.h"
 
 
+// irrlamb local patch: upstream splits on X/Y with Z up. irrlamb worlds are Y-up, so builds
+// that define dQUADTREE_Y_UP split on X/Z and read Center/Extents with Y as the up axis.
+// Keep this when updating the vendored ODE, _Physics::BuildStaticSpace depends on it.
+#ifdef dQUADTREE_Y_UP
+#define AXIS0 0
+#define AXIS1 2
+#define UP 1
+#else
 #define AXIS0 0
 #define AXIS1 1
 #define UP 2
+#endif
 
 //#define DRAWBLOCKS
 
@@ -102,13 +102,7 @@ void dxTriMeshData::buildData(const Point *Vertices, int VertexStide, unsigned V
     bool Single)
 {
     dxTriMeshData_Parent::buildData(Vertices, VertexStide, VertexCount, Indices, IndexCount, TriStride, in_Normals, Single);
-    dAASSERT(IndexCount % dMTV__MAX == 0);
-
-    m_Mesh.SetNbTriangles(IndexCount / dMTV__MAX);
-    m_Mesh.SetNbVertices(VertexCount);
-    m_Mesh.SetPointers(Indices, Vertices);
-    m_Mesh.SetStrides(TriStride, VertexStide);
-    m_Mesh.SetSingle(Single);
+    assignMeshInterface(Vertices, VertexStide, VertexCount, Indices, IndexCount, TriStride, Single);
 
     // Build tree
     // recommended in Opcode User Manual
@@ -122,6 +116,60 @@ void dxTriMeshData::buildData(const Point *Vertices, int VertexStide, unsigned V
 
     m_BVTree.Build(TreeBuilder);
 
+    updateModelAABB();
+
+    // user data (not used by OPCODE)
+    dIASSERT(m_InternalUseFlags == NULL);
+}
+
+bool dxTriMeshData::buildDataFromTree(const Point *Vertices, int VertexStide, unsigned VertexCount,
+    const IndexedTriangle *Indices, unsigned IndexCount, int TriStride,
+    const void *TreeNodes, sizeint TreeSize)
+{
+    dxTriMeshData_Parent::buildData(Vertices, VertexStide, VertexCount, Indices, IndexCount, TriStride, NULL, true);
+    assignMeshInterface(Vertices, VertexStide, VertexCount, Indices, IndexCount, TriStride, true);
+
+    // Nodes are copied and relinked, the saved array is not referenced afterwards
+    bool result = TreeSize % sizeof(AABBNoLeafNode) == 0
+        && m_BVTree.Load(&m_Mesh, (udword)(TreeSize / sizeof(AABBNoLeafNode)), (const AABBNoLeafNode *)TreeNodes);
+
+    updateModelAABB();
+
+    dIASSERT(m_InternalUseFlags == NULL);
+    return result;
+}
+
+sizeint dxTriMeshData::calculateTreeMemoryRequirement() const
+{
+    const AABBOptimizedTree *tree = m_BVTree.GetTree();
+    return tree != NULL ? (sizeint)tree->GetNbNodes() * sizeof(AABBNoLeafNode) : 0;
+}
+
+void dxTriMeshData::saveTree(void *TreeNodes) const
+{
+    const AABBOptimizedTree *tree = m_BVTree.GetTree();
+    if (tree != NULL)
+    {
+        dIASSERT(!m_BVTree.HasLeafNodes() && !m_BVTree.IsQuantized());
+        static_cast<const AABBNoLeafTree *>(tree)->Save((AABBNoLeafNode *)TreeNodes);
+    }
+}
+
+void dxTriMeshData::assignMeshInterface(const Point *Vertices, int VertexStide, unsigned VertexCount,
+    const IndexedTriangle *Indices, unsigned IndexCount, int TriStride,
+    bool Single)
+{
+    dAASSERT(IndexCount % dMTV__MAX == 0);
+
+    m_Mesh.SetNbTriangles(IndexCount / dMTV__MAX);
+    m_Mesh.SetNbVertices(VertexCount);
+    m_Mesh.SetPointers(Indices, Vertices);
+    m_Mesh.SetStrides(TriStride, VertexStide);
+    m_Mesh.SetSingle(Single);
+}
+
+void dxTriMeshData::updateModelAABB()
+{
     // compute model space AABB
     dVector3 AABBMax, AABBMin;
     calculateDataAABB(AABBMax, AABBMin);
@@ -130,9 +178,6 @@ void dxTriMeshData::buildData(const Point *Vertices, int VertexStide, unsigned V
     dScaleVector3(m_AABBCenter, REAL(0.5));
 
     dSubtractVectors3(m_AABBExtents, AABBMax, m_AABBCenter);
-
-    // user data (not used by OPCODE)
-    dIASSERT(m_InternalUseFlags == NULL);
 }
 
 
@@ -697,6 +742,35 @@ void dGeomTriMeshDataBuildSingle1(dTriMeshDataID g,
         true);
 }
 
+/*extern */
+int dGeomTriMeshDataBuildSingleFromTree(dTriMeshDataID g,
+    const void* Vertices, int VertexStride, int VertexCount, 
+    const void* Indices, int IndexCount, int TriStride,
+    const void* Tree, size_t TreeSize)
+{
+    dUASSERT(g, "The argument is not a trimesh data");
+
+    return g->buildDataFromTree((const Point *)Vertices, VertexStride, VertexCount, 
+        (const IndexedTriangle *)Indices, IndexCount, TriStride, 
+        Tree, TreeSize);
+}
+
+/*extern */
+size_t dGeomTriMeshDataGetTreeSize(dTriMeshDataID g)
+{
+    dUASSERT(g, "The argument is not a trimesh data");
+
+    return g->calculateTreeMemoryRequirement();
+}
+
+/*extern */
+void dGeomTriMeshDataGetTree(dTriMeshDataID g, void* Tree)
+{
+    dUASSERT(g, "The argument is not a trimesh data");
+
+    g->saveTree(Tree);
+}
+
 /*extern */
 void dGeomTriMeshDataBuildDouble1(dTriMeshDataID g,
     const void* Vertices, int VertexStride, int VertexCount, 
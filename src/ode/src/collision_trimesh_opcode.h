@@ -185,7 +185,20 @@ public:
         const dReal *in_Normals,
         bool Single);
 
+    /* Same as buildData but restores a tree saved by saveTree instead of building one */
+    bool buildDataFromTree(const Point *Vertices, int VertexStide, unsigned VertexCount,
+        const IndexedTriangle *Indices, unsigned IndexCount, int TriStride,
+        const void *TreeNodes, sizeint TreeSize);
+
+    sizeint calculateTreeMemoryRequirement() const;
+    void saveTree(void *TreeNodes) const;
+
 private:
+    void assignMeshInterface(const Point *Vertices, int VertexStide, unsigned VertexCount,
+        const IndexedTriangle *Indices, unsigned IndexCount, int TriStride,
+        bool Single);
+    void updateModelAABB();
+
     void calculateDataAABB(dVector3 &AABBMax, dVector3 &AABBMin);
     template<typename treal>
     void templateCalculateDataAABB(dVector3 &AABBMax, dVector3 &AABBMin);
@@ -672,6 +672,87 @@ void dBodySetTorque (dBodyID b, dReal x, dReal y, dReal z)
 }
 
 
+// dynamic state saved by dBodyGetState, followed by the average buffers
+struct dxBodyState {
+    unsigned flags;
+    dVector3 pos;
+    dMatrix3 R;
+    dQuaternion q;
+    dVector3 lvel,avel;
+    dVector3 facc,tacc;
+    dReal adis_timeleft;
+    int adis_stepsleft;
+    unsigned int average_counter;
+    int average_ready;
+};
+
+
+size_t dBodyGetStateSize (dBodyID b)
+{
+    dAASSERT (b);
+    return sizeof(dxBodyState) + 2 * sizeof(dVector3) * b->adis.average_samples;
+}
+
+
+void dBodyGetState (dBodyID b, void *data)
+{
+    dAASSERT (b && data);
+    dxBodyState *state = (dxBodyState *) data;
+    state->flags = b->flags;
+    dCopyVector4 (state->pos,b->posr.pos);
+    dCopyMatrix4x3 (state->R,b->posr.R);
+    dCopyVector4 (state->q,b->q);
+    dCopyVector4 (state->lvel,b->lvel);
+    dCopyVector4 (state->avel,b->avel);
+    dCopyVector4 (state->facc,b->facc);
+    dCopyVector4 (state->tacc,b->tacc);
+    state->adis_timeleft = b->adis_timeleft;
+    state->adis_stepsleft = b->adis_stepsleft;
+    state->average_counter = b->average_counter;
+    state->average_ready = b->average_ready;
+
+    dVector3 *buffers = (dVector3 *) (state + 1);
+    if (b->adis.average_samples > 0) {
+        memcpy (buffers,b->average_lvel_buffer,sizeof(dVector3) * b->adis.average_samples);
+        memcpy (buffers + b->adis.average_samples,b->average_avel_buffer,sizeof(dVector3) * b->adis.average_samples);
+    }
+}
+
+
+int dBodySetState (dBodyID b, const void *data, size_t size)
+{
+    dAASSERT (b && data);
+    if (size != dBodyGetStateSize (b))
+        return 0;
+
+    const dxBodyState *state = (const dxBodyState *) data;
+    b->flags = state->flags;
+    dCopyVector4 (b->posr.pos,state->pos);
+    dCopyMatrix4x3 (b->posr.R,state->R);
+    dCopyVector4 (b->q,state->q);
+    dCopyVector4 (b->lvel,state->lvel);
+    dCopyVector4 (b->avel,state->avel);
+    dCopyVector4 (b->facc,state->facc);
+    dCopyVector4 (b->tacc,state->tacc);
+    b->adis_timeleft = state->adis_timeleft;
+    b->adis_stepsleft = state->adis_stepsleft;
+    b->average_counter = state->average_counter;
+    b->average_ready = state->average_ready;
+
+    const dVector3 *buffers = (const dVector3 *) (state + 1);
+    if (b->adis.average_samples > 0) {
+        memcpy (b->average_lvel_buffer,buffers,sizeof(dVector3) * b->adis.average_samples);
+        memcpy (b->average_avel_buffer,buffers + b->adis.average_samples,sizeof(dVector3) * b->adis.average_samples);
+    }
+
+    // notify all attached geoms that this body has moved
+    for (dxGeom *geom = b->geom; geom; geom = dGeomGetBodyNext (geom))
+        dGeomMoved (geom);
+
+    return 1;
+}
+
+
 void dBodyGetRelPointPos (dBodyID b, dReal px, dReal py, dReal pz,
                           dVector3 result)
 {
@@ -938,8 +1019,9 @@ void dBodySetAutoDisableAverageSamplesCount (dBodyID b, unsigned int average_sam
     }
     if(b->adis.average_samples > 0)
     {
-        b->average_lvel_buffer = new dVector3[b->adis.average_samples];
-        b->average_avel_buffer = new dVector3[b->adis.average_samples];
+        // zeroed so dBodyGetState is repeatable before the buffers fill
+        b->average_lvel_buffer = new dVector3[b->adis.average_samples]();
+        b->average_avel_buffer = new dVector3[b->adis.average_samples]();
     }
     else
     {
@@ -17,6 +17,12 @@
 *******************************************************************************/
 #include <physics.h>
 #include <objects/object.h>
+#include <profiler.h>
+#include <config.h>
+#include <log.h>
+#include <level.h>
+#include <objectmanager.h>
+#include <scripting.h>
 #include <objects/template.h>
 #include <ode/odeinit.h>
 #include <ode/objects.h>
@@ -25,8 +31,13 @@
 #include <ode/export-dif.h>
 #include <ode/odemath.h>
 #include <glm/geometric.hpp>
+#include <algorithm>
+#include <cmath>
 
 const int MAX_CONTACTS = 32;
+const int STATIC_SPACE_MAX_DEPTH = 6;
+const dReal CONTACT_MERGE_DISTANCE = 0.01;
+const dReal CONTACT_MERGE_NORMAL = 0.99;
 
 _Physics Physics;
 
@@ -47,66 +58,114 @@ static void RayCallback(void *Data, dGeomID Geometry1, dGeomID Geometry2) {
 	}
 }
 
+// Reduces contacts to the deepest one plus the most spread out of the rest
+static int ReduceContacts(dContact *Contacts, int Count, int MaxContacts) {
+
+	// Move deepest contact to the front
+	int Deepest = 0;
+	for(int i = 1; i < Count; i++) {
+		if(Contacts[i].geom.depth > Contacts[Deepest].geom.depth)
+			Deepest = i;
+	}
+	std::swap(Contacts[0], Contacts[Deepest]);
+
+	// Drop contacts with the same position and normal as one already kept
+	int Kept = 1;
+	for(int i = 1; i < Count; i++) {
+		bool Duplicate = false;
+		for(int j = 0; j < Kept; j++) {
+			dVector3 Offset;
+			dSubtractVectors3(Offset, Contacts[i].geom.pos, Contacts[j].geom.pos);
+			if(dCalcVectorLengthSquare3(Offset) < CONTACT_MERGE_DISTANCE * CONTACT_MERGE_DISTANCE && dCalcVectorDot3(Contacts[i].geom.normal, Contacts[j].geom.normal) > CONTACT_MERGE_NORMAL) {
+				Duplicate = true;
+				break;
+			}
+		}
+
+		if(!Duplicate)
+			Contacts[Kept++] = Contacts[i];
+	}
+
+	// Pick the contacts farthest from the ones already kept
+	int Limit = std::min(Kept, MaxContacts);
+	for(int i = 1; i < Limit; i++) {
+		int Farthest = i;
+		dReal FarthestDistance = -1;
+		for(int j = i; j < Kept; j++) {
+			dReal Distance = dInfinity;
+			for(int k = 0; k < i; k++) {
+				dVector3 Offset;
+				dSubtractVectors3(Offset, Contacts[j].geom.pos, Contacts[k].geom.pos);
+				Distance = std::min(Distance, dCalcVectorLengthSquare3(Offset));
+			}
+
+			if(Distance > FarthestDistance) {
+				FarthestDistance = Distance;
+				Farthest = j;
+			}
+		}
+		std::swap(Contacts[i], Contacts[Farthest]);
+	}
+
+	return Limit;
+}
+
 // Near collision callback
 static void ODECallback(void *Data, dGeomID Geometry, dGeomID OtherGeometry) {
 	std::vector<_ObjectCollision> *ObjectCollisions = (std::vector<_ObjectCollision> *)Data;
-	dBodyID Body = dGeomGetBody(Geometry);
-	dBodyID OtherBody = dGeomGetBody(OtherGeometry);
-
-	// Get objects
-	_Object *Object =(_Object *)dGeomGetData(Geometry);
-	_Object *OtherObject = (_Object *)dGeomGetData(OtherGeometry);
 
 	// Get contacts
 	dContact Contacts[MAX_CONTACTS];
 	int Count = dCollide(Geometry, OtherGeometry, MAX_CONTACTS, &Contacts[0].geom, sizeof(dContact));
-	for(int i = 0; i < Count; i++) {
+	if(!Count)
+		return;
 
-		// Test for zones
-		bool Response = true;
-		if(Object->GetTemplate()->CollisionGroup & _Physics::FILTER_ZONE || OtherObject->GetTemplate()->CollisionGroup & _Physics::FILTER_ZONE)
-			Response = false;
-
-		// Collision response
-		if(Response) {
-			Contacts[i].surface.mode = dContactApprox1 | dContactSoftERP | dContactSoftCFM;
-			Contacts[i].surface.mu = std::min(Object->GetTemplate()->Friction, OtherObject->GetTemplate()->Friction);
-
-			// Handle ERP and CFM
-			Contacts[i].surface.soft_erp = std::min(Object->GetTemplate()->ERP, OtherObject->GetTemplate()->ERP);
-			Contacts[i].surface.soft_cfm = std::max(Object->GetTemplate()->CFM, OtherObject->GetTemplate()->CFM);
-
-			// Handle rolling friction
-			float RollingFriction = std::max(Object->GetTemplate()->RollingFriction, OtherObject->GetTemplate()->RollingFriction);
-			if(RollingFriction > 0) {
-				Contacts[i].surface.mode |= dContactRolling;
-				Contacts[i].surface.rho = RollingFriction;
-				Contacts[i].surface.rho2 = RollingFriction;
-			}
+	// Get objects
+	_Object *Object = (_Object *)dGeomGetData(Geometry);
+	_Object *OtherObject = (_Object *)dGeomGetData(OtherGeometry);
+	dBodyID Body = dGeomGetBody(Geometry);
+	dBodyID OtherBody = dGeomGetBody(OtherGeometry);
 
-			// Handle restitution
-			float Restitution = std::max(Object->GetTemplate()->Restitution, OtherObject->GetTemplate()->Restitution);
-			if(Restitution > 0) {
-				Contacts[i].surface.mode |= dContactBounce;
-				Contacts[i].surface.bounce = Restitution;
-				Contacts[i].surface.bounce_vel = 0;
-			}
+	// Get precomputed surface for the template pair
+	const _SurfacePair &SurfacePair = Level.GetSurfacePair(Object->GetTemplate(), OtherObject->GetTemplate());
 
-			// Create contact joint
+	// Limit the number of contacts
+	if(SurfacePair.MaxContacts > 0 && Count > 1)
+		Count = ReduceContacts(Contacts, Count, SurfacePair.MaxContacts);
+
+	// Handle contacts
+	glm::vec3 Normal(0.0f, 0.0f, 0.0f);
+	float MaxNormalY = -1.0f;
+	float MinNormalY = 1.0f;
+	float MaxDepth = 0.0f;
+	for(int i = 0; i < Count; i++) {
+
+		// Create contact joint
+		if(SurfacePair.Response) {
+			Contacts[i].surface = SurfacePair.Surface;
 			dJointID Joint = dJointCreateContact(Physics.GetWorld(), Physics.GetContactGroup(), &Contacts[i]);
 			dJointAttach(Joint, Body, OtherBody);
 		}
 
-		// Get normal
-		glm::vec3 Normal(Contacts[i].geom.normal[0], Contacts[i].geom.normal[1], Contacts[i].geom.normal[2]);
-
-		// Handle collision callback
-		ObjectCollisions->push_back(_ObjectCollision(Object, OtherObject, Normal, 1));
-		ObjectCollisions->push_back(_ObjectCollision(OtherObject, Object, Normal, -1));
+		// Accumulate contact info
+		const dContactGeom &Contact = Contacts[i].geom;
+		Normal += glm::vec3(Contact.normal[0], Contact.normal[1], Contact.normal[2]);
+		MaxNormalY = std::max(MaxNormalY, (float)Contact.normal[1]);
+		MinNormalY = std::min(MinNormalY, (float)Contact.normal[1]);
+		MaxDepth = std::max(MaxDepth, (float)Contact.depth);
 	}
+
+	// Get average normal
+	float Length = glm::length(Normal);
+	if(Length > 0.0f)
+		Normal /= Length;
+
+	// Add one collision event for each object
+	ObjectCollisions->push_back(_ObjectCollision(Object, OtherObject, Normal, MaxNormalY, MaxDepth, Count));
+	ObjectCollisions->push_back(_ObjectCollision(OtherObject, Object, -Normal, -MinNormalY, MaxDepth, Count));
 }
 
-// Initialize the physics system
+// Initialize the physics system for a level
 int _Physics::Init() {
 
 	// Enable physics
@@ -114,6 +173,48 @@ int _Physics::Init() {
 
 	// Initialize
 	dInitODE();
+
+	// Solve islands with a thread pool
+	if(Config.PhysicsThreads > 0) {
+		ThreadingImplementation = dThreadingAllocateMultiThreadedImplementation();
+		ThreadPool = dThreadingAllocateThreadPool(Config.PhysicsThreads, 0, dAllocateFlagBasicData, nullptr);
+		if(ThreadingImplementation && ThreadPool) {
+			dThreadingThreadPoolServeMultiThreadedImplementation(ThreadPool, ThreadingImplementation);
+		}
+		else {
+			Log.Write("Unable to create %d physics threads", Config.PhysicsThreads);
+			CloseThreads();
+		}
+	}
+
+	// Create world
+	CreateWorld();
+
+	return 1;
+}
+
+// Close the physics system
+int _Physics::Close() {
+	if(!Enabled)
+		return 0;
+
+	// Free world
+	DestroyWorld();
+
+	// Stop worker threads
+	CloseThreads();
+
+	// Close ODE
+	dCloseODE();
+
+	// Disable physics
+	Enabled = false;
+
+	return 1;
+}
+
+// Creates the world, spaces and contact group as they are on a fresh load
+void _Physics::CreateWorld() {
 	dRandSetSeed(0);
 
 	// Create world
@@ -121,39 +222,61 @@ int _Physics::Init() {
 	dWorldSetGravity(World, 0, -9.81, 0);
 	dWorldSetCFM(World, 0.0);
 
-	// Create space
-	Space = dHashSpaceCreate(0);
+	// Step with the thread pool
+	if(ThreadingImplementation) {
+		dWorldSetStepThreadingImplementation(World, dThreadingImplementationGetFunctions(ThreadingImplementation), ThreadingImplementation);
+
+		// Islands share the global random seed used for constraint reordering, so step them in order
+		dWorldSetStepIslandsProcessingMaxThreadCount(World, 1);
+	}
+
+	// Create spaces for geometry without bodies and for rigid bodies, static geometry is sorted into a quadtree by BuildStaticSpace once the level and its scripts have spawned
+	StaticSpace = dSimpleSpaceCreate(0);
+	DynamicSpace = dHashSpaceCreate(0);
 
 	// Create contact group
 	ContactGroup = dJointGroupCreate(0);
-
-	return 1;
 }
 
-// Close the physics system
-int _Physics::Close() {
-	if(!Enabled)
-		return 0;
+// Frees the world, spaces and contact group
+void _Physics::DestroyWorld() {
 
 	// Free contact group
 	if(ContactGroup)
 		dJointGroupDestroy(ContactGroup);
+	ContactGroup = nullptr;
 
-	// Free space
-	if(Space)
-		dSpaceDestroy(Space);
+	// Free spaces
+	if(StaticSpace)
+		dSpaceDestroy(StaticSpace);
+	if(DynamicSpace)
+		dSpaceDestroy(DynamicSpace);
+	StaticSpace = nullptr;
+	DynamicSpace = nullptr;
 
 	// Free world
-	if(World)
+	if(World) {
+		if(ThreadingImplementation)
+			dWorldSetStepThreadingImplementation(World, nullptr, nullptr);
 		dWorldDestroy(World);
+	}
+	World = nullptr;
+}
 
-	// Close ODE
-	dCloseODE();
+// Stops the thread pool
+void _Physics::CloseThreads() {
+	if(ThreadingImplementation)
+		dThreadingImplementationShutdownProcessing(ThreadingImplementation);
 
-	// Disable physics
-	Enabled = false;
+	if(ThreadPool) {
+		dThreadingFreeThreadPool(ThreadPool);
+		ThreadPool = nullptr;
+	}
 
-	return 1;
+	if(ThreadingImplementation) {
+		dThreadingFreeImplementation(ThreadingImplementation);
+		ThreadingImplementation = nullptr;
+	}
 }
 
 // Updates the physics system
@@ -161,26 +284,229 @@ void _Physics::Update(float FrameTime) {
 	if(Enabled) {
 
 		// Handle collisions
-		dSpaceCollide(Space, &ObjectCollisions, &ODECallback);
+		{
+			_ProfilerScope Scope(_Profiler::SECTION_COLLIDE);
+			dSpaceCollide(DynamicSpace, &ObjectCollisions, &ODECallback);
+
+			// Look up each dynamic geom in the static quadtree, dSpaceCollide2 on two spaces would scan the smaller one linearly
+			int Count = dSpaceGetNumGeoms(DynamicSpace);
+			for(int i = 0; i < Count; i++)
+				dSpaceCollide2(dSpaceGetGeom(DynamicSpace, i), (dGeomID)StaticSpace, &ObjectCollisions, &ODECallback);
+		}
 
 		// Handle callbacks
-		for(auto ObjectCollision : ObjectCollisions)
-			ObjectCollision.Object->HandleCollision(ObjectCollision);
-		ObjectCollisions.clear();
+		{
+			_ProfilerScope Scope(_Profiler::SECTION_CALLBACKS);
+			for(const auto &ObjectCollision : ObjectCollisions)
+				ObjectCollision.Object->HandleCollision(ObjectCollision);
+			ObjectCollisions.clear();
+		}
 
 		// Run timestep
-		dWorldQuickStep(World, FrameTime);
+		{
+			_ProfilerScope Scope(_Profiler::SECTION_STEP);
+			dWorldQuickStep(World, FrameTime);
+		}
 
 		// Remove contact joints
 		dJointGroupEmpty(ContactGroup);
 	}
 }
 
-// Resets the physics world
+// Combines the surface properties of two templates
+_SurfacePair _Physics::GetSurfacePair(const _Template *Template, const _Template *OtherTemplate) {
+	_SurfacePair SurfacePair;
+	SurfacePair.Surface = dSurfaceParameters();
+
+	// Use the smallest contact limit set by either template
+	SurfacePair.MaxContacts = Template->MaxContacts;
+	if(OtherTemplate->MaxContacts > 0 && (SurfacePair.MaxContacts <= 0 || OtherTemplate->MaxContacts < SurfacePair.MaxContacts))
+		SurfacePair.MaxContacts = OtherTemplate->MaxContacts;
+
+	// Test for zones
+	SurfacePair.Response = !(Template->CollisionGroup & FILTER_ZONE || OtherTemplate->CollisionGroup & FILTER_ZONE);
+
+	// Friction
+	dSurfaceParameters &Surface = SurfacePair.Surface;
+	Surface.mode = dContactApprox1 | dContactSoftERP | dContactSoftCFM;
+	Surface.mu = std::min(Template->Friction, OtherTemplate->Friction);
+
+	// Handle ERP and CFM
+	Surface.soft_erp = std::min(Template->ERP, OtherTemplate->ERP);
+	Surface.soft_cfm = std::max(Template->CFM, OtherTemplate->CFM);
+
+	// Handle rolling friction
+	float RollingFriction = std::max(Template->RollingFriction, OtherTemplate->RollingFriction);
+	if(RollingFriction > 0) {
+		Surface.mode |= dContactRolling;
+		Surface.rho = RollingFriction;
+		Surface.rho2 = RollingFriction;
+	}
+
+	// Handle restitution
+	float Restitution = std::max(Template->Restitution, OtherTemplate->Restitution);
+	if(Restitution > 0) {
+		Surface.mode |= dContactBounce;
+		Surface.bounce = Restitution;
+		Surface.bounce_vel = 0;
+	}
+
+	return SurfacePair;
+}
+
+// Recreates the world for a level reset, ODE stays initialized for geometry kept across resets
 void _Physics::Reset() {
-	Physics.Close();
-	Physics.Init();
-	Physics.SetEnabled(true);
+	DestroyWorld();
+	CreateWorld();
+	Enabled = true;
+}
+
+// Moves static geometry into a quadtree fitted to its bounds on X/Z, called after the level and its scripts have spawned
+void _Physics::BuildStaticSpace() {
+	if(!Enabled)
+		return;
+
+	// Get static geometry in creation order and the bounds of the finite parts
+	std::vector<dGeomID> StaticGeometry;
+	dReal Min[2] = { dInfinity, dInfinity };
+	dReal Max[2] = { -dInfinity, -dInfinity };
+	for(auto &Object : ObjectManager.GetObjects()) {
+		dGeomID Geometry = Object->GetGeometry();
+		if(!Geometry || dGeomGetSpace(Geometry) != StaticSpace)
+			continue;
+
+		StaticGeometry.push_back(Geometry);
+
+		// Planes are unbounded and go in the root block
+		dReal AABB[6];
+		dGeomGetAABB(Geometry, AABB);
+		if(!std::isfinite(AABB[0]) || !std::isfinite(AABB[1]) || !std::isfinite(AABB[4]) || !std::isfinite(AABB[5]))
+			continue;
+
+		Min[0] = std::min(Min[0], AABB[0]);
+		Max[0] = std::max(Max[0], AABB[1]);
+		Min[1] = std::min(Min[1], AABB[4]);
+		Max[1] = std::max(Max[1], AABB[5]);
+	}
+
+	// Fit the tree to the level with a small margin, a level without finite geometry gets a unit tree
+	// The vendored quadtree is patched to split on X/Z when dQUADTREE_Y_UP is defined
+	#ifndef dQUADTREE_Y_UP
+		#error "The static quadtree needs dQUADTREE_Y_UP, see collision_quadtreespace.cpp"
+	#endif
+	dVector3 Center = { 0, 0, 0 };
+	dVector3 Extents = { 1, 1, 1 };
+	if(Min[0] <= Max[0]) {
+		Center[0] = (Min[0] + Max[0]) * 0.5;
+		Center[2] = (Min[1] + Max[1]) * 0.5;
+		Extents[0] = (Max[0] - Min[0]) * 0.5 + 1;
+		Extents[2] = (Max[1] - Min[1]) * 0.5 + 1;
+	}
+
+	// Aim for about one geom per leaf
+	int Depth = 1;
+	while(Depth < STATIC_SPACE_MAX_DEPTH && ((size_t)1 << (2 * Depth)) < StaticGeometry.size())
+		Depth++;
+
+	// Move geometry over in creation order, so a reset level builds the same tree
+	dSpaceID Space = dQuadTreeSpaceCreate(0, Center, Extents, Depth);
+	for(auto &Geometry : StaticGeometry) {
+		dSpaceRemove(StaticSpace, Geometry);
+		dSpaceAdd(Space, Geometry);
+	}
+
+	dSpaceDestroy(StaticSpace);
+	StaticSpace = Space;
+}
+
+// Captures the state of the world and every object
+void _Physics::Snapshot(_PhysicsSnapshot &Snapshot) {
+	Snapshot.Clear();
+
+	// Objects
+	ObjectManager.Snapshot(Snapshot);
+
+	// Random state used by the solver and by scripts
+	Snapshot.Put(dRandGetSeed());
+	Scripting.SaveRandomState(Snapshot);
+
+	// Contacts are generated in the order geoms appear in the dynamic space, and moved geoms jump to the front
+	if(Enabled) {
+		int Count = dSpaceGetNumGeoms(DynamicSpace);
+		Snapshot.Put(Count);
+		for(int i = 0; i < Count; i++) {
+			dGeomID Geometry = dSpaceGetGeom(DynamicSpace, i);
+			const _Object *Object = (const _Object *)dGeomGetData(Geometry);
+			Snapshot.Put(Object->GetOrder());
+			Snapshot.Put((char)dGeomIsDirty(Geometry));
+		}
+	}
+	else
+		Snapshot.Put(0);
+}
+
+// Puts the world back to a snapshot. Returns false without changes if an object in it has been deleted since. A
+// truncated snapshot also returns false, possibly after objects were deleted or loaded, so callers must rebuild the level.
+bool _Physics::Restore(_PhysicsSnapshot &Snapshot) {
+	Snapshot.Rewind();
+
+	// Restore objects, removing any created after the snapshot
+	if(!ObjectManager.Restore(Snapshot))
+		return false;
+
+	// Random state
+	dRandSetSeed(Snapshot.Get<unsigned long>());
+	Scripting.LoadRandomState(Snapshot);
+
+	// Read the order of the dynamic space
+	int Count = Snapshot.Get<int>();
+	std::vector<std::pair<uint32_t, char> > Geoms((size_t)std::max(Count, 0));
+	for(auto &Geom : Geoms) {
+		Geom.first = Snapshot.Get<uint32_t>();
+		Geom.second = Snapshot.Get<char>();
+	}
+	if(Snapshot.IsOverrun()) {
+		Log.Write("_Physics::Restore - Snapshot is truncated");
+		return false;
+	}
+
+	if(Enabled) {
+
+		// Re-add geoms last to first so they end up in the original order, then mark them clean
+		for(auto Iterator = Geoms.rbegin(); Iterator != Geoms.rend(); ++Iterator) {
+			_Object *Object = ObjectManager.GetObjectByOrder(Iterator->first);
+			dGeomID Geometry = Object ? Object->GetGeometry() : nullptr;
+			if(Geometry && dGeomGetSpace(Geometry) == DynamicSpace) {
+				dSpaceRemove(DynamicSpace, Geometry);
+				dSpaceAdd(DynamicSpace, Geometry);
+			}
+		}
+		dSpaceClean(DynamicSpace);
+
+		// Move the geoms that were dirty back to the front
+		for(auto Iterator = Geoms.rbegin(); Iterator != Geoms.rend(); ++Iterator) {
+			_Object *Object = ObjectManager.GetObjectByOrder(Iterator->first);
+			dGeomID Geometry = Object ? Object->GetGeometry() : nullptr;
+			if(Iterator->second && Geometry && dGeomGetSpace(Geometry) == DynamicSpace) {
+				const dReal *Position = dGeomGetPosition(Geometry);
+				dGeomSetPosition(Geometry, Position[0], Position[1], Position[2]);
+			}
+		}
+
+		// Add static geometry back in creation order, the order it had after spawning
+		std::vector<dGeomID> StaticGeometry;
+		for(auto &Object : ObjectManager.GetObjects()) {
+			dGeomID Geometry = Object->GetGeometry();
+			if(Geometry && dGeomGetSpace(Geometry) == StaticSpace) {
+				dSpaceRemove(StaticSpace, Geometry);
+				StaticGeometry.push_back(Geometry);
+			}
+		}
+		for(auto &Geometry : StaticGeometry)
+			dSpaceAdd(StaticSpace, Geometry);
+	}
+
+	return true;
 }
 
 // Performs raycasting on the world and returns the point of collision
@@ -200,7 +526,8 @@ bool _Physics::RaycastWorld(const glm::vec3 &Start, glm::vec3 &End) {
 
 		// Check collisions
 		dVector4 HitPosition = { 0, 0, 0, dInfinity };
-		dSpaceCollide2(Ray, (dGeomID)Space, HitPosition, &RayCallback);
+		dSpaceCollide2(Ray, (dGeomID)StaticSpace, HitPosition, &RayCallback);
+		dSpaceCollide2(Ray, (dGeomID)DynamicSpace, HitPosition, &RayCallback);
 
 		// Cleanup
 		dGeomDestroy(Ray);
@@ -236,3 +563,55 @@ glm::vec3 _Physics::QuaternionToEuler(const glm::quat &Quaternion) {
 
 	return glm::degrees(glm::vec3(EulerAngles.X, EulerAngles.Y, EulerAngles.Z));
 }
+
+// Appends data to the snapshot
+void _PhysicsSnapshot::PutData(const void *Value, size_t Size) {
+	std::memcpy(Allocate(Size), Value, Size);
+}
+
+// Appends a string with its length
+void _PhysicsSnapshot::PutString(const std::string &Value) {
+	Put((uint32_t)Value.size());
+	PutData(Value.data(), Value.size());
+}
+
+// Grows the snapshot and returns the space added, valid until the next write
+void *_PhysicsSnapshot::Allocate(size_t Size) {
+	size_t Offset = Data.size();
+	Data.resize(Offset + Size);
+
+	return Data.data() + Offset;
+}
+
+// Copies data out of the snapshot
+void _PhysicsSnapshot::GetData(void *Value, size_t Size) {
+	const void *Source = View(Size);
+	if(Source)
+		std::memcpy(Value, Source, Size);
+	else
+		std::memset(Value, 0, Size);
+}
+
+// Reads a string written by PutString
+std::string _PhysicsSnapshot::GetString() {
+	uint32_t Size = Get<uint32_t>();
+	const char *Source = (const char *)View(Size);
+	if(!Source)
+		return "";
+
+	return std::string(Source, Size);
+}
+
+// Points at the next bytes in the snapshot, nullptr past the end
+const void *_PhysicsSnapshot::View(size_t Size) {
+	if(Overrun || Data.size() - Cursor < Size) {
+		Cursor = Data.size();
+		Overrun = true;
+		return nullptr;
+	}
+
+	const void *Value = Data.data() + Cursor;
+	Cursor += Size;
+
+	return Value;
+}
@@ -17,24 +17,79 @@
 *******************************************************************************/
 #pragma once
 #include <ode/common.h>
+#include <ode/threading_impl.h>
+#include <ode/contact.h>
 #include <glm/vec3.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
 
 // Constants
 const float PHYSICS_TIMESTEP = 1.0f / 500.0f;
 
 // Forward Declarations
 class _Object;
+struct _Template;
 
 // Structures
 struct _ObjectCollision {
-	_ObjectCollision(_Object *Object, _Object *OtherObject, const glm::vec3 &Normal, float NormalScale) : Object(Object), OtherObject(OtherObject), Normal(Normal), NormalScale(NormalScale) { }
+	_ObjectCollision(_Object *Object, _Object *OtherObject, const glm::vec3 &Normal, float MaxNormalY, float MaxDepth, int ContactCount) : Object(Object), OtherObject(OtherObject), Normal(Normal), MaxNormalY(MaxNormalY), MaxDepth(MaxDepth), ContactCount(ContactCount) { }
 
 	_Object *Object;
 	_Object *OtherObject;
+
+	// Contacts for the object pair in one step, with normals facing the object
 	glm::vec3 Normal;
-	float NormalScale;
+	float MaxNormalY;
+	float MaxDepth;
+	int ContactCount;
+};
+
+// Contact response between two templates
+struct _SurfacePair {
+	dSurfaceParameters Surface;
+	int MaxContacts;
+	bool Response;
+};
+
+// Dynamic state of the world and its objects packed into one buffer
+class _PhysicsSnapshot {
+
+	public:
+
+		_PhysicsSnapshot() : Cursor(0), Overrun(false) { }
+
+		void Clear() { Data.clear(); Rewind(); }
+		bool IsEmpty() const { return Data.empty(); }
+		size_t GetSize() const { return Data.size(); }
+
+		// Append a value in its in-memory representation
+		template<typename T> void Put(const T &Value) { PutData(&Value, sizeof(T)); }
+		void PutData(const void *Value, size_t Size);
+		void PutString(const std::string &Value);
+		void *Allocate(size_t Size);
+
+		// Copy a value out of the buffer, returns zeroed data past the end
+		void Rewind() { Cursor = 0; Overrun = false; }
+		bool IsOverrun() const { return Overrun; }
+		template<typename T> T Get() {
+			T Value = T();
+			GetData(&Value, sizeof(T));
+			return Value;
+		}
+		template<typename T> void Get(T &Value) { Value = Get<T>(); }
+		void GetData(void *Value, size_t Size);
+		std::string GetString();
+		const void *View(size_t Size);
+
+	private:
+
+		std::vector<char> Data;
+		size_t Cursor;
+		bool Overrun;
+
 };
 
 // Classes
@@ -50,33 +105,53 @@ class _Physics {
 			FILTER_ZONE			= 0x8,
 		};
 
-		_Physics() : Enabled(false) { }
+		_Physics() : Enabled(false), HeightfieldTerrain(true), World(nullptr), ContactGroup(nullptr), StaticSpace(nullptr), DynamicSpace(nullptr), ThreadingImplementation(nullptr), ThreadPool(nullptr) { }
 		int Init();
 		int Close();
 
 		void Update(float FrameTime);
 		void Reset();
+		void BuildStaticSpace();
+
+		void Snapshot(_PhysicsSnapshot &Snapshot);
+		bool Restore(_PhysicsSnapshot &Snapshot);
+
+		static _SurfacePair GetSurfacePair(const _Template *Template, const _Template *OtherTemplate);
 
 		glm::vec3 QuaternionToEuler(const glm::quat &Quaternion);
 		bool RaycastWorld(const glm::vec3 &Start, glm::vec3 &End);
 
 		dWorldID GetWorld() { return World; }
 		dJointGroupID GetContactGroup() { return ContactGroup; }
-		dSpaceID GetSpace() { return Space; }
+		dSpaceID GetStaticSpace() { return StaticSpace; }
+		dSpaceID GetDynamicSpace() { return DynamicSpace; }
+		dSpaceID GetSpace(bool Static) { return Static ? StaticSpace : DynamicSpace; }
 
 		void SetEnabled(bool Value) { Enabled = Value; }
 		bool IsEnabled() const { return Enabled; }
+		void SetHeightfieldTerrain(bool Value) { HeightfieldTerrain = Value; }
+		bool HasHeightfieldTerrain() const { return HeightfieldTerrain; }
 		void RemoveFilter(int &Value, int Filter);
 
 		void Dump();
 
 	private:
 
+		void CreateWorld();
+		void DestroyWorld();
+		void CloseThreads();
+
 		bool Enabled;
+		bool HeightfieldTerrain;
 
 		dWorldID World;
 		dJointGroupID ContactGroup;
-		dSpaceID Space;
+		dSpaceID StaticSpace;
+		dSpaceID DynamicSpace;
+
+		// Worker threads for the island solver
+		dThreadingImplementationID ThreadingImplementation;
+		dThreadingThreadPoolID ThreadPool;
 
 		std::vector<_ObjectCollision> ObjectCollisions;
 
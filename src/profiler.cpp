@@ -0,0 +1,139 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <profiler.h>
+#include <save.h>
+#include <log.h>
+#include <fstream>
+#include <ctime>
+
+_Profiler Profiler;
+
+// Section names used by the overlay and csv header
+static const char *SectionNames[_Profiler::SECTION_COUNT] = {
+	"Collide",
+	"Callbacks",
+	"Step",
+	"Objects",
+	"Scripts",
+	"Replay",
+	"Audio",
+	"Scene",
+	"GUI",
+};
+
+// Constructor
+_Profiler::_Profiler() {
+	Visible = false;
+	Current = _Frame();
+	FrameCount = 0;
+}
+
+// Finishes the current frame and stores it in the history
+void _Profiler::EndFrame(double FrameTime) {
+	Current.FrameTime = FrameTime;
+
+	// Only this thread writes, so publishing the new count is enough for readers
+	uint32_t Count = FrameCount.load(std::memory_order_relaxed);
+	History[Count % PROFILER_HISTORY] = Current;
+	FrameCount.store(Count + 1, std::memory_order_release);
+
+	Current = _Frame();
+}
+
+// Get the average timings over the last few frames
+void _Profiler::GetAverage(_Frame &Average, int Frames) const {
+	Average = _Frame();
+
+	uint32_t Count = FrameCount.load(std::memory_order_acquire);
+	if(Frames > PROFILER_HISTORY)
+		Frames = PROFILER_HISTORY;
+	if((uint32_t)Frames > Count)
+		Frames = Count;
+	if(Frames <= 0)
+		return;
+
+	// Sum frames
+	for(int i = 0; i < Frames; i++) {
+		const _Frame &Frame = History[(Count - 1 - i) % PROFILER_HISTORY];
+		for(int j = 0; j < SECTION_COUNT; j++)
+			Average.Times[j] += Frame.Times[j];
+		Average.FrameTime += Frame.FrameTime;
+		Average.Steps += Frame.Steps;
+	}
+
+	// Divide
+	for(int j = 0; j < SECTION_COUNT; j++)
+		Average.Times[j] /= Frames;
+	Average.FrameTime /= Frames;
+	Average.Steps /= Frames;
+}
+
+// Write the frame history to a csv file in milliseconds
+bool _Profiler::WriteCSV(const std::string &Path) const {
+	std::ofstream File(Path.c_str());
+	if(!File)
+		return false;
+
+	// Write header
+	File << "frame,frametime,steps";
+	for(int i = 0; i < SECTION_COUNT; i++)
+		File << "," << SectionNames[i];
+	File << "\n";
+
+	// Write oldest frame first
+	uint32_t Count = FrameCount.load(std::memory_order_acquire);
+	uint32_t Start = Count > PROFILER_HISTORY ? Count - PROFILER_HISTORY : 0;
+	for(uint32_t i = Start; i < Count; i++) {
+		const _Frame &Frame = History[i % PROFILER_HISTORY];
+		File << i << "," << Frame.FrameTime * 1000.0 << "," << Frame.Steps;
+		for(int j = 0; j < SECTION_COUNT; j++)
+			File << "," << Frame.Times[j] * 1000.0;
+		File << "\n";
+	}
+
+	return true;
+}
+
+// Write the frame history to a timestamped file in the save directory
+bool _Profiler::SaveCSV() const {
+
+	// Get time
+	time_t Now;
+	time(&Now);
+
+	// Get filename
+	char Filename[32];
+	strftime(Filename, 32, "profile-%Y%m%d-%H%M%S.csv", localtime(&Now));
+
+	std::string FilePath = Save.SavePath + Filename;
+	if(!WriteCSV(FilePath)) {
+		Log.Write("Unable to write profile: %s", FilePath.c_str());
+		return false;
+	}
+
+	Log.Write("Wrote profile: %s", FilePath.c_str());
+	return true;
+}
+
+// Get the display name of a section
+const char *_Profiler::GetSectionName(int Section) {
+	if(Section < 0 || Section >= SECTION_COUNT)
+		return "";
+
+	return SectionNames[Section];
+}
@@ -0,0 +1,99 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// Constants
+const int PROFILER_HISTORY = 1024;
+const int PROFILER_AVERAGE_FRAMES = 60;
+
+// Classes
+class _Profiler {
+
+	public:
+
+		enum SectionType {
+			SECTION_COLLIDE,
+			SECTION_CALLBACKS,
+			SECTION_STEP,
+			SECTION_OBJECTS,
+			SECTION_SCRIPTS,
+			SECTION_REPLAY,
+			SECTION_AUDIO,
+			SECTION_SCENE,
+			SECTION_GUI,
+			SECTION_COUNT,
+		};
+
+		// Timings for one rendered frame in seconds
+		struct _Frame {
+			double Times[SECTION_COUNT];
+			double FrameTime;
+			int Steps;
+		};
+
+		_Profiler();
+
+		void AddTime(SectionType Section, double Time) { Current.Times[Section] += Time; }
+		void AddStep() { Current.Steps++; }
+		void EndFrame(double FrameTime);
+
+		void GetAverage(_Frame &Average, int Frames=PROFILER_AVERAGE_FRAMES) const;
+		bool WriteCSV(const std::string &Path) const;
+		bool SaveCSV() const;
+
+		static const char *GetSectionName(int Section);
+
+		// Attributes
+		bool Visible;
+
+	private:
+
+		// Frame being recorded
+		_Frame Current;
+
+		// Ring buffer of finished frames
+		_Frame History[PROFILER_HISTORY];
+		std::atomic<uint32_t> FrameCount;
+
+};
+
+// Adds the time spent in a scope to a profiler section
+class _ProfilerScope {
+
+	public:
+
+		_ProfilerScope(_Profiler::SectionType Section) : Section(Section), Start(std::chrono::high_resolution_clock::now()) { }
+		~_ProfilerScope();
+
+	private:
+
+		_Profiler::SectionType Section;
+		std::chrono::high_resolution_clock::time_point Start;
+
+};
+
+// Singletons
+extern _Profiler Profiler;
+
+// Stop timing
+inline _ProfilerScope::~_ProfilerScope() {
+	Profiler.AddTime(Section, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count());
+}
@@ -21,10 +21,26 @@
 #include <config.h>
 #include <level.h>
 #include <framework.h>
+#include <algorithm>
 #include <sstream>
+#include <cstring>
 
 _Replay Replay;
 
+// Starts the writer thread
+int _Replay::Init() {
+	Writer.Start();
+
+	return 1;
+}
+
+// Finishes pending writes
+int _Replay::Close() {
+	Writer.Stop();
+
+	return 1;
+}
+
 // Start recording a replay
 void _Replay::StartRecording() {
 	if(State != STATE_NONE)
@@ -33,6 +49,8 @@ void _Replay::StartRecording() {
 	// Set up state
 	State = STATE_RECORDING;
 	Time = 0;
+	NextKeyframeTime = 0;
+	Keyframes.clear();
 
 	// Get header information
 	ReplayVersion = REPLAY_VERSION;
@@ -41,9 +59,7 @@ void _Replay::StartRecording() {
 
 	// Create replay file for object data
 	ReplayDataFile = Save.ReplayPath + "replay.dat";
-	File.open(ReplayDataFile.c_str(), std::ios::out | std::ios::binary);
-	if(!File.is_open())
-		Log.Write("Unable to open: %s", ReplayDataFile.c_str());
+	Writer.Open(ReplayDataFile);
 }
 
 // Stops the recording process
@@ -51,81 +67,87 @@ void _Replay::StopRecording() {
 
 	if(State == STATE_RECORDING) {
 		State = STATE_NONE;
-		File.close();
-		remove(ReplayDataFile.c_str());
+		Writer.Remove();
 	}
 }
 
-// Saves the current replay out to a file
-bool _Replay::SaveReplay(const std::string &PlayerDescription, bool Autosave, bool Won) {
+// Queues the current replay to be saved by the writer thread, a given path is written without adding it to the replay index
+bool _Replay::SaveReplay(const std::string &PlayerDescription, bool Autosave, bool Won, const std::string &Path) {
 	Description = PlayerDescription;
 	Timestamp = time(nullptr);
 	FinishTime = Time;
 
-	// Flush current replay file
-	File.flush();
-
 	// Get new file name
-	std::stringstream ReplayFilePath;
-	ReplayFilePath << Save.ReplayPath << (uint32_t)Timestamp << "-" << Level.LevelName << ".replay";
-
-	// Open new file
-	std::fstream NewFile(ReplayFilePath.str().c_str(), std::ios::out | std::ios::binary);
-	if(!NewFile) {
-		Log.Write("Unable to open for writing: %s", ReplayFilePath.str().c_str());
-		return false;
-	}
+	std::stringstream ReplayFileName;
+	ReplayFileName << (uint32_t)Timestamp << "-" << Level.LevelName << ".replay";
 
 	// Write platform
+	std::vector<char> Header;
 	char Platform = PLATFORM;
-	WriteChunk(NewFile, PACKET_PLATFORM, (char *)&Platform, sizeof(Platform));
+	WriteChunk(Header, PACKET_PLATFORM, (char *)&Platform, sizeof(Platform));
 
 	// Write replay version
-	WriteChunk(NewFile, PACKET_REPLAYVERSION, (char *)&ReplayVersion, sizeof(ReplayVersion));
+	WriteChunk(Header, PACKET_REPLAYVERSION, (char *)&ReplayVersion, sizeof(ReplayVersion));
 
 	// Write level version
-	WriteChunk(NewFile, PACKET_LEVELVERSION, (char *)&LevelVersion, sizeof(LevelVersion));
+	WriteChunk(Header, PACKET_LEVELVERSION, (char *)&LevelVersion, sizeof(LevelVersion));
 
 	// Write timestep value
-	WriteChunk(NewFile, PACKET_TIMESTEP, (char *)&Framework.GetTimeStep(), sizeof(Framework.GetTimeStep()));
+	WriteChunk(Header, PACKET_TIMESTEP, (char *)&Framework.GetTimeStep(), sizeof(Framework.GetTimeStep()));
 
 	// Write level file
-	WriteChunk(NewFile, PACKET_LEVELFILE, LevelName.c_str(), LevelName.length());
+	WriteChunk(Header, PACKET_LEVELFILE, LevelName.c_str(), LevelName.length());
 
 	// Write player's description of replay
-	WriteChunk(NewFile, PACKET_DESCRIPTION, Description.c_str(), Description.length());
+	WriteChunk(Header, PACKET_DESCRIPTION, Description.c_str(), Description.length());
 
 	// Write time stamp
-	WriteChunk(NewFile, PACKET_DATE, (char *)&Timestamp, sizeof(Timestamp));
+	WriteChunk(Header, PACKET_DATE, (char *)&Timestamp, sizeof(Timestamp));
 
 	// Write finish time
-	WriteChunk(NewFile, PACKET_FINISHTIME, (char *)&FinishTime, sizeof(FinishTime));
+	WriteChunk(Header, PACKET_FINISHTIME, (char *)&FinishTime, sizeof(FinishTime));
 
 	// Write autosave value
-	WriteChunk(NewFile, PACKET_AUTOSAVE, (char *)&Autosave, sizeof(Autosave));
+	WriteChunk(Header, PACKET_AUTOSAVE, (char *)&Autosave, sizeof(Autosave));
 
 	// Write won value
-	WriteChunk(NewFile, PACKET_WON, (char *)&Won, sizeof(Won));
-
-	// Finished with header
-	NewFile.put(PACKET_OBJECTDATA);
-	uint32_t Dummy = 0;
-	NewFile.write((char *)&Dummy, sizeof(Dummy));
-
-	// Copy current data to new replay file
-	std::ifstream CurrentReplayFile(ReplayDataFile.c_str(), std::ios::in | std::ios::binary);
-	char Buffer[4096];
-	std::streamsize BytesRead;
-	while(!CurrentReplayFile.eof()) {
-		CurrentReplayFile.read(Buffer, 4096);
-		BytesRead = CurrentReplayFile.gcount();
-
-		if(BytesRead)
-			NewFile.write(Buffer, (uint32_t)BytesRead);
+	WriteChunk(Header, PACKET_WON, (char *)&Won, sizeof(Won));
+
+	// Finished with header, the writer appends the compressed size and data
+	Header.push_back(PACKET_OBJECTDATA);
+
+	// Write keyframe index after object data
+	std::vector<char> Trailer;
+	uint32_t KeyframeCount = (uint32_t)Keyframes.size();
+	Trailer.push_back((char)PACKET_INDEX);
+	Trailer.insert(Trailer.end(), (char *)&FinishTime, (char *)&FinishTime + sizeof(FinishTime));
+	Trailer.insert(Trailer.end(), (char *)&KeyframeCount, (char *)&KeyframeCount + sizeof(KeyframeCount));
+	for(const auto &Keyframe : Keyframes) {
+		Trailer.insert(Trailer.end(), (char *)&Keyframe.Time, (char *)&Keyframe.Time + sizeof(Keyframe.Time));
+		Trailer.insert(Trailer.end(), (char *)&Keyframe.Offset, (char *)&Keyframe.Offset + sizeof(Keyframe.Offset));
 	}
 
-	CurrentReplayFile.close();
-	NewFile.close();
+	// Compression and disk writes happen on the writer thread
+	if(Path != "") {
+		Writer.Save(Path, Header, Trailer);
+		return true;
+	}
+	Writer.Save(Save.ReplayPath + ReplayFileName.str(), Header, Trailer);
+
+	// Add to the replay index, the modified time is filled in once the menu sees the file
+	_ReplayIndex Index;
+	Index.Filename = ReplayFileName.str();
+	Index.LevelName = LevelName;
+	Index.Description = Description;
+	Index.ReplayVersion = ReplayVersion;
+	Index.LevelVersion = LevelVersion;
+	Index.TimeStep = Framework.GetTimeStep();
+	Index.FinishTime = FinishTime;
+	Index.Timestamp = Timestamp;
+	Index.Platform = PLATFORM;
+	Index.Autosave = Autosave;
+	Index.Won = Won;
+	Save.UpdateReplayIndex(std::vector<_ReplayIndex>(1, Index), std::vector<std::string>());
 
 	return true;
 }
@@ -139,20 +161,20 @@ void _Replay::LoadHeader() {
 	uint32_t PacketSize;
 	bool Done = false;
 	char Buffer[1024];
-	while(!File.eof() && !Done) {
-		PacketType = File.get();
-		File.read((char *)&PacketSize, sizeof(PacketSize));
+	while(!Done && Reader.GetRemaining()) {
+		PacketType = Reader.Get<char>();
+		Reader.Get(PacketSize);
 		switch(PacketType) {
 			case PACKET_REPLAYVERSION:
-				File.read((char *)&ReplayVersion, sizeof(ReplayVersion));
-				if(ReplayVersion != REPLAY_VERSION)
+				Reader.Get(ReplayVersion);
+				if(!IsSupportedVersion())
 					Done = true;
 
 				if(Debug)
 					Log.Write("ReplayVersion=%d, PacketSize=%d sizeof=%d", ReplayVersion, PacketSize, sizeof(ReplayVersion));
 			break;
 			case PACKET_LEVELVERSION:
-				File.read((char *)&LevelVersion, sizeof(LevelVersion));
+				Reader.Get(LevelVersion);
 
 				if(Debug)
 					Log.Write("LevelVersion=%d, PacketSize=%d sizeof=%d", LevelVersion, PacketSize, sizeof(LevelVersion));
@@ -160,7 +182,7 @@ void _Replay::LoadHeader() {
 			case PACKET_LEVELFILE:
 				if(PacketSize > 1024)
 					PacketSize = 1024;
-				File.read(Buffer, PacketSize);
+				Reader.GetData(Buffer, PacketSize);
 				Buffer[PacketSize] = 0;
 				LevelName = Buffer;
 
@@ -170,7 +192,7 @@ void _Replay::LoadHeader() {
 			case PACKET_DESCRIPTION:
 				if(PacketSize > 1024)
 					PacketSize = 1024;
-				File.read(Buffer, PacketSize);
+				Reader.GetData(Buffer, PacketSize);
 				Buffer[PacketSize] = 0;
 				Description = Buffer;
 
@@ -180,53 +202,94 @@ void _Replay::LoadHeader() {
 			case PACKET_DATE:
 				if(PacketSize > 8)
 					PacketSize = 8;
-				File.read((char *)&Timestamp, PacketSize);
+				Reader.GetData(&Timestamp, PacketSize);
 
 				if(Debug)
 					Log.Write("Timestamp=%d, PacketSize=%d sizeof=%d", Timestamp, PacketSize, sizeof(Timestamp));
 			break;
 			case PACKET_FINISHTIME:
-				File.read((char *)&FinishTime, sizeof(FinishTime));
+				Reader.Get(FinishTime);
 
 				if(Debug)
 					Log.Write("FinishTime=%f, PacketSize=%d sizeof=%d", FinishTime, PacketSize, sizeof(FinishTime));
 			break;
 			case PACKET_TIMESTEP:
-				File.read((char *)&TimeStep, sizeof(TimeStep));
+				Reader.Get(TimeStep);
 
 				if(Debug)
 					Log.Write("TimeStep=%f, PacketSize=%d sizeof=%d", TimeStep, PacketSize, sizeof(TimeStep));
 			break;
 			case PACKET_AUTOSAVE:
-				Autosave = File.get();
+				Autosave = Reader.Get<char>();
 
 				if(Debug)
 					Log.Write("Autosave=%d, PacketSize=%d", Autosave, PacketSize);
 			break;
 			case PACKET_WON:
-				Won = File.get();
+				Won = Reader.Get<char>();
 
 				if(Debug)
 					Log.Write("Won=%d, PacketSize=%d", Won, PacketSize);
 			break;
 			case PACKET_PLATFORM:
-				Platform = File.get();
+				Platform = Reader.Get<char>();
 			break;
 			case PACKET_OBJECTDATA:
+				DataStart = Reader.GetOffset();
+				DataSize = PacketSize;
 				Done = true;
 			break;
 			default:
-				File.ignore(PacketSize);
+				Reader.Skip(PacketSize);
 			break;
 		}
 	}
 }
 
+// Points the reader at object data, decompressing it for newer versions
+bool _Replay::LoadData() {
+
+	// Older versions are read straight from the mapped file
+	if(ReplayVersion < 6) {
+		Reader.SetRange(DataStart, Reader.GetMappingSize() - DataStart);
+		return true;
+	}
+
+	// Inflate from the mapped file into memory
+	if(!Reader.Inflate(DataStart, DataSize)) {
+		Log.Write("Corrupt replay data");
+		return false;
+	}
+
+	return true;
+}
+
+// Load the keyframe index stored after the object data
+void _Replay::LoadIndex() {
+	if(ReplayVersion < 5 || DataSize == 0)
+		return;
+
+	// Check for index packet
+	Reader.SetRange(DataStart + DataSize, Reader.GetMappingSize());
+	if(Reader.Get<uint8_t>() == PACKET_INDEX) {
+		Reader.Skip(sizeof(float));
+		uint32_t KeyframeCount = Reader.Get<uint32_t>();
+
+		// Read entries
+		if(KeyframeCount <= Reader.GetRemaining() / sizeof(_ReplayKeyframe)) {
+			Keyframes.resize(KeyframeCount);
+			Reader.GetData(Keyframes.data(), sizeof(_ReplayKeyframe) * KeyframeCount);
+		}
+		if(Reader.IsOverrun())
+			Keyframes.clear();
+	}
+}
+
 // Write a replay chunk
-void _Replay::WriteChunk(std::fstream &OutFile, char Type, const char *Data, uint32_t Size) {
-   OutFile.put(Type);
-   OutFile.write((char *)&Size, sizeof(Size));
-   OutFile.write(Data, Size);
+void _Replay::WriteChunk(std::vector<char> &Output, char Type, const char *Data, uint32_t Size) {
+	Output.push_back(Type);
+	Output.insert(Output.end(), (char *)&Size, (char *)&Size + sizeof(Size));
+	Output.insert(Output.end(), Data, Data + Size);
 }
 
 // Updates the replay timer
@@ -234,6 +297,36 @@ void _Replay::Update(float FrameTime) {
 	Time += FrameTime;
 }
 
+// Adds a keyframe to the index and writes its event
+void _Replay::StartKeyframe() {
+	NextKeyframeTime = Time + REPLAY_KEYFRAME_INTERVAL;
+
+	_ReplayKeyframe Keyframe;
+	Keyframe.Time = Time;
+	Keyframe.Offset = (uint32_t)Writer.GetOffset();
+	Keyframes.push_back(Keyframe);
+
+	WriteEvent(PACKET_KEYFRAME);
+}
+
+// Returns the last keyframe at or before a time, nullptr if none
+const _ReplayKeyframe *_Replay::FindKeyframe(float Time) const {
+
+	auto Iterator = std::upper_bound(Keyframes.begin(), Keyframes.end(), Time, [](float Value, const _ReplayKeyframe &Keyframe) {
+		return Value < Keyframe.Time;
+	});
+	if(Iterator == Keyframes.begin())
+		return nullptr;
+
+	return &*(Iterator - 1);
+}
+
+// Move the read position to an offset in the object data
+void _Replay::SeekData(uint32_t Offset) {
+	Reader.Seek(Offset);
+	EndOfData = false;
+}
+
 // Determines if a packet is required
 bool _Replay::NeedsPacket() {
 
@@ -248,14 +341,16 @@ bool _Replay::LoadReplay(const std::string &ReplayFile, bool HeaderOnly) {
 	Autosave = false;
 	Won = false;
 	Platform = 0;
+	DataStart = 0;
+	DataSize = 0;
+	EndOfData = false;
+	Keyframes.clear();
 
 	// Try absolute path
-	File.open(ReplayFile.c_str(), std::ios::in | std::ios::binary);
-	if(!File) {
+	if(!Reader.Open(ReplayFile)) {
 
 		// Pass only file name
-		File.open((Save.ReplayPath + ReplayFile).c_str(), std::ios::in | std::ios::binary);
-		if(!File)
+		if(!Reader.Open(Save.ReplayPath + ReplayFile))
 			return false;
 	}
 
@@ -263,33 +358,127 @@ bool _Replay::LoadReplay(const std::string &ReplayFile, bool HeaderOnly) {
 	LoadHeader();
 
 	// Read only the header
-	if(HeaderOnly)
-		File.close();
+	if(HeaderOnly) {
+		Reader.Close();
+		return true;
+	}
 
-	return true;
+	// Read index and object data
+	LoadIndex();
+
+	return LoadData();
 }
 
 // Stops replay
 void _Replay::StopReplay() {
 
 	State = STATE_NONE;
-	File.close();
+	Reader.Close();
 }
 
 // Returns true if the replay is done playing
 bool _Replay::ReplayStopped() {
 
-	return File.eof();
+	return EndOfData || Reader.IsOverrun();
 }
 
 // Write replay event
 void _Replay::WriteEvent(uint8_t Type) {
-	File.put(Type);
-	File.write((char *)&Time, sizeof(Time));
+
+	// Write out full blocks between packets
+	Writer.FlushBlock();
+
+	Writer.Put(Type);
+	Writer.Put(Time);
 }
 
 // Reads a packet header
 void _Replay::ReadEvent(_ReplayEvent &Packet) {
-	Packet.Type = File.get();
-	File.read((char *)&Packet.Timestamp, sizeof(Packet.Timestamp));
+
+	// Running out of data ends the replay
+	if(Reader.GetRemaining() < sizeof(Packet.Type) + sizeof(Packet.Timestamp)) {
+		EndOfData = true;
+		return;
+	}
+
+	Packet.Type = Reader.Get<uint8_t>();
+	Packet.Timestamp = Reader.Get<float>();
+
+	// Index follows the object data
+	if(Packet.Type == PACKET_INDEX)
+		EndOfData = true;
+}
+
+// Skips the data of a packet whose header was just read
+void _Replay::SkipPacket(uint8_t Type) {
+	switch(Type) {
+		case PACKET_MOVEMENT: {
+			int16_t ObjectCount = Reader.Get<int16_t>();
+			if(ReplayVersion >= 6) {
+				for(int i = 0; i < ObjectCount; i++) {
+					_ReplayOrientation Unused;
+					Reader.Skip(sizeof(uint16_t));
+					Reader.GetMovement(Unused);
+				}
+			}
+			else
+				Reader.Skip(ObjectCount * sizeof(_ReplayMovementData));
+		} break;
+		case PACKET_CREATE: {
+			const _ReplayCreateData *Data = Reader.View<_ReplayCreateData>();
+			Reader.Skip(sizeof(float) * (Data->PositionType == 1 ? 4 : 3) + sizeof(float) * 3);
+		} break;
+		case PACKET_DELETE:
+			Reader.Skip(sizeof(_ReplayDeleteData));
+		break;
+		case PACKET_CAMERA:
+			Reader.Skip(sizeof(_ReplayCameraData));
+		break;
+		case PACKET_ORBDEACTIVATE:
+			Reader.Skip(sizeof(_ReplayOrbDeactivateData));
+		break;
+		case PACKET_INPUT:
+			Reader.Skip(sizeof(_ReplayInputData));
+		break;
+		case PACKET_PLAYERSPEED:
+			Reader.Skip(sizeof(_ReplayPlayerSpeedData));
+		break;
+		case PACKET_KEYFRAME: {
+			Reader.Skip(sizeof(_ReplayCameraData));
+			int16_t ObjectCount = Reader.Get<int16_t>();
+			Reader.Skip(ObjectCount * sizeof(_ReplayKeyframeObjectData));
+		} break;
+		case PACKET_HASH: {
+			Reader.Skip(sizeof(uint32_t));
+			uint16_t ObjectCount = Reader.Get<uint16_t>();
+			Reader.Skip(ObjectCount * sizeof(_ReplayObjectHash));
+		} break;
+		default:
+		break;
+	}
+}
+
+// Write a delta encoded movement sample and make it the new base
+void _Replay::WriteMovement(const _ReplayOrientation &Value, _ReplayOrientation &Base) {
+	bool PositionChanged = std::memcmp(Value.Position, Base.Position, sizeof(Value.Position)) != 0;
+	bool RotationChanged = Value.RotationIndex != Base.RotationIndex || std::memcmp(Value.Rotation, Base.Rotation, sizeof(Value.Rotation)) != 0;
+
+	// Write flags
+	uint8_t Flags = (uint8_t)(Value.RotationIndex | (PositionChanged << 2) | (RotationChanged << 3));
+	Writer.Put(Flags);
+
+	// Write position delta
+	if(PositionChanged) {
+		for(int i = 0; i < 3; i++)
+			Writer.PutVarint(Value.Position[i] - Base.Position[i]);
+	}
+
+	// Rotations are only deltas when the dropped component is the same
+	if(RotationChanged) {
+		bool Delta = Value.RotationIndex == Base.RotationIndex;
+		for(int i = 0; i < 3; i++)
+			Writer.PutVarint(Value.Rotation[i] - (Delta ? Base.Rotation[i] : 0));
+	}
+
+	Base = Value;
 }
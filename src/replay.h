@@ -18,10 +18,14 @@
 #pragma once
 
 // Libraries
-#include <fstream>
+#include <replaywriter.h>
+#include <replayreader.h>
+#include <vector>
 
 // Constants
-const int REPLAY_VERSION = 4;
+const int REPLAY_VERSION = 9;
+const int REPLAY_MINIMUM_VERSION = 4;
+const float REPLAY_KEYFRAME_INTERVAL = 1.0f;
 
 // Event packet structure
 struct _ReplayEvent {
@@ -29,6 +33,18 @@ struct _ReplayEvent {
 	float Timestamp;
 };
 
+// Quantized state hash of one object, folded to 16 bits
+struct _ReplayObjectHash {
+	uint16_t ObjectID;
+	uint16_t Hash;
+};
+
+// Keyframe index entry, offset is relative to the start of object data
+struct _ReplayKeyframe {
+	float Time;
+	uint32_t Offset;
+};
+
 // Classes
 class _Replay {
 
@@ -57,6 +73,9 @@ class _Replay {
 			PACKET_ORBDEACTIVATE,
 			PACKET_INPUT,
 			PACKET_PLAYERSPEED,
+			PACKET_KEYFRAME,
+			PACKET_INDEX,
+			PACKET_HASH,
 		};
 
 		enum StateType {
@@ -65,10 +84,13 @@ class _Replay {
 			STATE_REPLAYING,
 		};
 
+		int Init();
+		int Close();
+
 		// Recording functions
 		void StartRecording();
 		void StopRecording();
-		bool SaveReplay(const std::string &PlayerDescription, bool Autosave=false, bool Won=false);
+		bool SaveReplay(const std::string &PlayerDescription, bool Autosave=false, bool Won=false, const std::string &Path="");
 
 		// Playback functions
 		bool LoadReplay(const std::string &ReplayFile, bool HeaderOnly=false);
@@ -81,14 +103,27 @@ class _Replay {
 		bool IsRecording() const { return State == STATE_RECORDING; }
 		bool IsReplaying() const { return State == STATE_REPLAYING; }
 		bool NeedsPacket();
+		bool NeedsKeyframe() const { return State == STATE_RECORDING && Time >= NextKeyframeTime; }
+		void StartKeyframe();
 
-		std::fstream &GetFile() { return File; }
+		// Seeking
+		const _ReplayKeyframe *FindKeyframe(float Time) const;
+		void SeekData(uint32_t Offset);
+		bool HasIndex() const { return !Keyframes.empty(); }
+
+		_ReplayReader &GetReader() { return Reader; }
+		_ReplayWriter &GetWriter() { return Writer; }
 		void WriteEvent(uint8_t Type);
 		void ReadEvent(_ReplayEvent &Packet);
+		void SkipPacket(uint8_t Type);
+
+		// Movement encoding
+		void WriteMovement(const _ReplayOrientation &Value, _ReplayOrientation &Base);
 
 		const std::string &GetLevelName() { return LevelName; }
 		const std::string &GetDescription() { return Description; }
 		int32_t GetVersion() { return ReplayVersion; }
+		bool IsSupportedVersion() const { return ReplayVersion >= REPLAY_MINIMUM_VERSION && ReplayVersion <= REPLAY_VERSION; }
 		int32_t GetLevelVersion() { return LevelVersion; }
 		float GetTimeStep() { return TimeStep; }
 		float GetFinishTime() { return FinishTime; }
@@ -100,7 +135,9 @@ class _Replay {
 	private:
 
 		void LoadHeader();
-		void WriteChunk(std::fstream &OutFile, char Type, const char *Data, uint32_t Size);
+		void LoadIndex();
+		bool LoadData();
+		void WriteChunk(std::vector<char> &Output, char Type, const char *Data, uint32_t Size);
 
 		// Header
 		int32_t ReplayVersion;
@@ -117,8 +154,18 @@ class _Replay {
 		// Replay data file name
 		std::string ReplayDataFile;
 
-		// File stream
-		std::fstream File;
+		// Mapped replay file and recording writer
+		_ReplayReader Reader;
+		_ReplayWriter Writer;
+
+		// Object data location in the file
+		size_t DataStart;
+		uint32_t DataSize;
+		bool EndOfData;
+
+		// Keyframes
+		std::vector<_ReplayKeyframe> Keyframes;
+		float NextKeyframeTime;
 
 		// Time management
 		float Time;
@@ -0,0 +1,265 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <replayreader.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+	#include <fstream>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+// Maps a replay file into memory, the cursor covers the whole file
+bool _ReplayReader::Open(const std::string &Path) {
+	Close();
+
+	#ifdef _WIN32
+
+		// Read the file into memory
+		std::ifstream File(Path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+		if(!File)
+			return false;
+
+		MappingSize = (size_t)File.tellg();
+		Mapping = new char[MappingSize ? MappingSize : 1];
+		File.seekg(0);
+		File.read(Mapping, (std::streamsize)MappingSize);
+		if(!File) {
+			Close();
+			return false;
+		}
+	#else
+		int FileDescriptor = open(Path.c_str(), O_RDONLY);
+		if(FileDescriptor == -1)
+			return false;
+
+		// Map file, empty files have nothing to map
+		struct stat FileStat;
+		if(fstat(FileDescriptor, &FileStat) == 0 && FileStat.st_size > 0) {
+			void *Address = mmap(nullptr, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+			if(Address != MAP_FAILED) {
+				Mapping = (char *)Address;
+				MappingSize = (size_t)FileStat.st_size;
+				madvise(Address, MappingSize, MADV_SEQUENTIAL);
+			}
+		}
+		close(FileDescriptor);
+
+		if(!Mapping)
+			return false;
+	#endif
+
+	SetRange(0, MappingSize);
+
+	return true;
+}
+
+// Unmaps the file and releases decompressed data
+void _ReplayReader::Close() {
+	if(Mapping) {
+		#ifdef _WIN32
+			delete[] Mapping;
+		#else
+			munmap(Mapping, MappingSize);
+		#endif
+	}
+
+	Mapping = nullptr;
+	MappingSize = 0;
+	Buffer.clear();
+	Buffer.shrink_to_fit();
+	Begin = End = Cursor = nullptr;
+	Overrun = false;
+}
+
+// Restricts the cursor to part of the file
+void _ReplayReader::SetRange(size_t Offset, size_t Size) {
+	if(Offset > MappingSize)
+		Offset = MappingSize;
+	if(Size > MappingSize - Offset)
+		Size = MappingSize - Offset;
+
+	Begin = Cursor = Mapping + Offset;
+	End = Begin + Size;
+	Overrun = false;
+}
+
+// Takes ownership of decompressed data and moves the cursor to it
+void _ReplayReader::SetBuffer(std::vector<char> &Data) {
+	Buffer.swap(Data);
+	Begin = Cursor = Buffer.data();
+	End = Begin + Buffer.size();
+	Overrun = false;
+}
+
+// Decompresses part of the file and moves the cursor to the result
+bool _ReplayReader::Inflate(size_t Offset, size_t Size) {
+	if(Offset > MappingSize || Size > MappingSize - Offset)
+		return false;
+
+	z_stream ZStream;
+	std::memset(&ZStream, 0, sizeof(ZStream));
+	if(inflateInit(&ZStream) != Z_OK)
+		return false;
+
+	// Inflate from the mapped file
+	std::vector<char> UncompressedData;
+	UncompressedData.reserve(Size * 4);
+	char OutBuffer[16384];
+	int Result;
+	ZStream.avail_in = (uInt)Size;
+	ZStream.next_in = (Bytef *)(Mapping + Offset);
+	do {
+		ZStream.avail_out = sizeof(OutBuffer);
+		ZStream.next_out = (Bytef *)OutBuffer;
+		Result = inflate(&ZStream, Z_NO_FLUSH);
+		if(Result != Z_OK && Result != Z_STREAM_END)
+			break;
+
+		UncompressedData.insert(UncompressedData.end(), OutBuffer, OutBuffer + sizeof(OutBuffer) - ZStream.avail_out);
+	} while(Result != Z_STREAM_END);
+	inflateEnd(&ZStream);
+
+	if(Result != Z_STREAM_END)
+		return false;
+
+	// Read from memory
+	SetBuffer(UncompressedData);
+
+	return true;
+}
+
+// Moves the cursor to an offset in the current range
+void _ReplayReader::Seek(size_t Offset) {
+	if(Offset > (size_t)(End - Begin))
+		Offset = (size_t)(End - Begin);
+
+	Cursor = Begin + Offset;
+	Overrun = false;
+}
+
+// Copies raw bytes out of the data
+void _ReplayReader::GetData(void *Data, size_t Size) {
+	if(!Reserve(Size)) {
+		std::memset(Data, 0, Size);
+		return;
+	}
+
+	std::memcpy(Data, Cursor, Size);
+	Cursor += Size;
+}
+
+// Reads a zigzag encoded variable length integer
+int32_t _ReplayReader::GetVarint() {
+	uint32_t Encoded = 0;
+	for(int Shift = 0; Shift < 35; Shift += 7) {
+		if(Cursor >= End) {
+			Overrun = true;
+			break;
+		}
+
+		uint8_t Byte = (uint8_t)*Cursor++;
+		Encoded |= (uint32_t)(Byte & 0x7f) << Shift;
+		if(!(Byte & 0x80))
+			break;
+	}
+
+	return (int32_t)(Encoded >> 1) ^ -(int32_t)(Encoded & 1);
+}
+
+// Read a delta encoded movement sample into the base
+void _ReplayReader::GetMovement(_ReplayOrientation &Base) {
+	uint8_t Flags = Get<uint8_t>();
+	int RotationIndex = Flags & 3;
+
+	// Read position delta
+	if(Flags & 4) {
+		for(int i = 0; i < 3; i++)
+			Base.Position[i] += GetVarint();
+	}
+
+	// Read rotation
+	if(Flags & 8) {
+		bool Delta = RotationIndex == Base.RotationIndex;
+		for(int i = 0; i < 3; i++)
+			Base.Rotation[i] = GetVarint() + (Delta ? Base.Rotation[i] : 0);
+		Base.RotationIndex = RotationIndex;
+	}
+}
+
+// Clear the delta base
+void _ReplayOrientation::Reset() {
+	for(int i = 0; i < 3; i++) {
+		Position[i] = 0;
+		Rotation[i] = 0;
+	}
+	RotationIndex = -1;
+}
+
+// Quantize a position and rotation
+void _ReplayOrientation::Set(const glm::vec3 &Value, const glm::quat &Quaternion) {
+	for(int i = 0; i < 3; i++)
+		Position[i] = (int32_t)std::lround(Value[i] * REPLAY_POSITION_SCALE);
+
+	// Find largest component
+	float Components[4] = { Quaternion.x, Quaternion.y, Quaternion.z, Quaternion.w };
+	RotationIndex = 0;
+	for(int i = 1; i < 4; i++) {
+		if(std::abs(Components[i]) > std::abs(Components[RotationIndex]))
+			RotationIndex = i;
+	}
+
+	// Store the other three with the largest one positive
+	float Sign = Components[RotationIndex] < 0.0f ? -1.0f : 1.0f;
+	int Index = 0;
+	for(int i = 0; i < 4; i++) {
+		if(i != RotationIndex)
+			Rotation[Index++] = (int32_t)std::lround(Components[i] * Sign * REPLAY_ROTATION_SCALE);
+	}
+}
+
+// Get the position and rotation back from quantized values
+void _ReplayOrientation::Get(glm::vec3 &Value, glm::quat &Quaternion) const {
+	for(int i = 0; i < 3; i++)
+		Value[i] = Position[i] / REPLAY_POSITION_SCALE;
+
+	if(RotationIndex < 0) {
+		Quaternion = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		return;
+	}
+
+	// Rebuild largest component from the unit length
+	float Components[4];
+	float Sum = 0.0f;
+	int Index = 0;
+	for(int i = 0; i < 4; i++) {
+		if(i == RotationIndex)
+			continue;
+
+		Components[i] = Rotation[Index++] / REPLAY_ROTATION_SCALE;
+		Sum += Components[i] * Components[i];
+	}
+	Components[RotationIndex] = std::sqrt(std::max(0.0f, 1.0f - Sum));
+
+	Quaternion = glm::quat(Components[3], Components[0], Components[1], Components[2]);
+}
@@ -0,0 +1,172 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Constants
+const float REPLAY_POSITION_SCALE = 1024.0f;
+const float REPLAY_ROTATION_SCALE = 32767.0f * 1.41421356f;
+
+// Quantized position and smallest three rotation, used as the base for delta encoded movement
+struct _ReplayOrientation {
+	_ReplayOrientation() { Reset(); }
+
+	void Reset();
+	void Set(const glm::vec3 &Position, const glm::quat &Rotation);
+	void Get(glm::vec3 &Position, glm::quat &Rotation) const;
+
+	int32_t Position[3];
+	int32_t Rotation[3];
+	int RotationIndex;
+};
+
+// Packet payloads, read in place through _ReplayReader::View
+#pragma pack(push, 1)
+struct _ReplayCreateData {
+	int16_t TemplateID;
+	int16_t ObjectID;
+	uint8_t PositionType;
+};
+
+struct _ReplayDeleteData {
+	int16_t ObjectID;
+};
+
+struct _ReplayCameraData {
+	float Position[3];
+	float Target[3];
+};
+
+struct _ReplayOrbDeactivateData {
+	int16_t ObjectID;
+	float Length;
+};
+
+struct _ReplayInputData {
+	float PushX;
+	float PushZ;
+	float Yaw;
+	float Pitch;
+	bool Jumped;
+};
+
+struct _ReplayPlayerSpeedData {
+	float Speed;
+};
+
+struct _ReplayMovementData {
+	int16_t ObjectID;
+	float Position[3];
+	float Rotation[3];
+};
+
+struct _ReplayKeyframeObjectData {
+	int16_t TemplateID;
+	int16_t ObjectID;
+	uint8_t PositionType;
+	float Orientation[4];
+	float Rotation[3];
+	uint8_t OrbState;
+	float OrbTime;
+	float DeactivateLength;
+};
+#pragma pack(pop)
+
+// Classes
+class _ReplayReader {
+
+	public:
+
+		_ReplayReader() : Mapping(nullptr), MappingSize(0), Begin(nullptr), End(nullptr), Cursor(nullptr), Overrun(false) { }
+		~_ReplayReader() { Close(); }
+
+		// Replay file
+		bool Open(const std::string &Path);
+		void Close();
+		const char *GetMapping() const { return Mapping; }
+		size_t GetMappingSize() const { return MappingSize; }
+
+		// Set the range the cursor moves in
+		void SetRange(size_t Offset, size_t Size);
+		void SetBuffer(std::vector<char> &Data);
+		bool Inflate(size_t Offset, size_t Size);
+
+		// Cursor
+		void Seek(size_t Offset);
+		size_t GetOffset() const { return (size_t)(Cursor - Begin); }
+		size_t GetRemaining() const { return (size_t)(End - Cursor); }
+		bool IsOverrun() const { return Overrun; }
+		void Skip(size_t Size) { if(Reserve(Size)) Cursor += Size; }
+
+		// Copy a value out of the data
+		template<typename T> T Get() {
+			T Value = T();
+			if(Reserve(sizeof(T))) {
+				std::memcpy(&Value, Cursor, sizeof(T));
+				Cursor += sizeof(T);
+			}
+			return Value;
+		}
+		template<typename T> void Get(T &Value) { Value = Get<T>(); }
+		void GetData(void *Data, size_t Size);
+		int32_t GetVarint();
+		void GetMovement(_ReplayOrientation &Base);
+
+		// Point at a packed payload without copying, returns zeroed data past the end
+		template<typename T> const T *View() {
+			static const T Empty = T();
+			if(!Reserve(sizeof(T)))
+				return &Empty;
+
+			const T *Value = reinterpret_cast<const T *>(Cursor);
+			Cursor += sizeof(T);
+			return Value;
+		}
+
+	private:
+
+		bool Reserve(size_t Size) {
+			if((size_t)(End - Cursor) >= Size)
+				return true;
+
+			Cursor = End;
+			Overrun = true;
+			return false;
+		}
+
+		// Whole file
+		char *Mapping;
+		size_t MappingSize;
+
+		// Decompressed data
+		std::vector<char> Buffer;
+
+		// Current range
+		const char *Begin;
+		const char *End;
+		const char *Cursor;
+		bool Overrun;
+
+};
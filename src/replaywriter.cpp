@@ -0,0 +1,298 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <replaywriter.h>
+#include <log.h>
+#include <zlib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// Starts the writer thread
+void _ReplayWriter::Start() {
+	if(Thread.joinable())
+		return;
+
+	Head = 0;
+	Tail = 0;
+	Thread = std::thread(&_ReplayWriter::Run, this);
+}
+
+// Finishes queued work and stops the writer thread
+void _ReplayWriter::Stop() {
+	if(!Thread.joinable())
+		return;
+
+	// Wait for pending messages to fit in the queue
+	_ReplayWriterMessage Message;
+	Message.Type = MESSAGE_QUIT;
+	Submit(Message);
+	while(!Pump())
+		std::this_thread::yield();
+
+	Thread.join();
+}
+
+// Starts writing recorded data to a new file
+void _ReplayWriter::Open(const std::string &Path) {
+	Buffer.clear();
+	Written = 0;
+
+	_ReplayWriterMessage Message;
+	Message.Type = MESSAGE_OPEN;
+	Message.Path = Path;
+	Submit(Message);
+}
+
+// Discards recorded data and deletes the file
+void _ReplayWriter::Remove() {
+	Buffer.clear();
+	Written = 0;
+
+	_ReplayWriterMessage Message;
+	Message.Type = MESSAGE_REMOVE;
+	Submit(Message);
+}
+
+// Flushes recorded data and queues a replay file made from the header, compressed data and trailer
+void _ReplayWriter::Save(const std::string &Path, std::vector<char> &Header, std::vector<char> &Trailer) {
+	Flush();
+
+	_ReplayWriterMessage Message;
+	Message.Type = MESSAGE_SAVE;
+	Message.Path = Path;
+	Message.Data.swap(Header);
+	Message.Trailer.swap(Trailer);
+	Message.Size = Written;
+	Submit(Message);
+}
+
+// Appends raw bytes to the buffer
+void _ReplayWriter::PutData(const void *Data, size_t Size) {
+	size_t Offset = Buffer.size();
+	Buffer.resize(Offset + Size);
+	std::memcpy(&Buffer[Offset], Data, Size);
+}
+
+// Appends a zigzag encoded variable length integer
+void _ReplayWriter::PutVarint(int32_t Value) {
+	uint32_t Encoded = ((uint32_t)Value << 1) ^ (uint32_t)(Value >> 31);
+	while(Encoded >= 0x80) {
+		Buffer.push_back((char)(Encoded | 0x80));
+		Encoded >>= 7;
+	}
+	Buffer.push_back((char)Encoded);
+}
+
+// Hands buffered data to the writer thread
+void _ReplayWriter::Flush() {
+	if(Buffer.empty())
+		return;
+
+	Written += Buffer.size();
+
+	// Swap buffers so the queue slot's storage is reused for recording
+	DataMessage.Type = MESSAGE_DATA;
+	DataMessage.Data.swap(Buffer);
+	Submit(DataMessage);
+	Buffer.swap(DataMessage.Data);
+	Buffer.clear();
+}
+
+// Blocks until the writer thread has processed every queued message
+void _ReplayWriter::Wait() {
+	if(!Thread.joinable())
+		return;
+
+	while(!Pump() || Tail.load(std::memory_order_acquire) != Head.load(std::memory_order_relaxed)) {
+		Wake.notify_one();
+		std::this_thread::yield();
+	}
+}
+
+// Adds a message to the queue, or holds it if the queue is full
+void _ReplayWriter::Submit(_ReplayWriterMessage &Message) {
+
+	// Process immediately without a writer thread
+	if(!Thread.joinable()) {
+		Process(Message);
+		Message.Data.clear();
+		return;
+	}
+
+	// Keep messages in order behind anything already waiting
+	if(!Pump()) {
+		Pending.push_back(std::move(Message));
+		Message = _ReplayWriterMessage();
+		return;
+	}
+
+	size_t HeadIndex = Head.load(std::memory_order_relaxed);
+	if(HeadIndex - Tail.load(std::memory_order_acquire) >= REPLAY_WRITER_QUEUE_SIZE) {
+		Pending.push_back(std::move(Message));
+		Message = _ReplayWriterMessage();
+		return;
+	}
+
+	// Swap into the free slot, the message gets back the slot's old storage
+	_ReplayWriterMessage &Slot = Queue[HeadIndex % REPLAY_WRITER_QUEUE_SIZE];
+	Slot.Type = Message.Type;
+	Slot.Size = Message.Size;
+	Slot.Path.swap(Message.Path);
+	Slot.Data.swap(Message.Data);
+	Slot.Trailer.swap(Message.Trailer);
+	Head.store(HeadIndex + 1, std::memory_order_release);
+	Wake.notify_one();
+}
+
+// Moves held messages into the queue, returns true when none are left
+bool _ReplayWriter::Pump() {
+	while(!Pending.empty()) {
+		size_t HeadIndex = Head.load(std::memory_order_relaxed);
+		if(HeadIndex - Tail.load(std::memory_order_acquire) >= REPLAY_WRITER_QUEUE_SIZE)
+			return false;
+
+		_ReplayWriterMessage &Slot = Queue[HeadIndex % REPLAY_WRITER_QUEUE_SIZE];
+		Slot = std::move(Pending.front());
+		Pending.pop_front();
+		Head.store(HeadIndex + 1, std::memory_order_release);
+		Wake.notify_one();
+	}
+
+	return true;
+}
+
+// Writer thread loop
+void _ReplayWriter::Run() {
+	bool Done = false;
+	while(!Done) {
+
+		// Sleep until the queue has work, the timeout covers a missed notify
+		size_t TailIndex = Tail.load(std::memory_order_relaxed);
+		if(TailIndex == Head.load(std::memory_order_acquire)) {
+			std::unique_lock<std::mutex> Lock(WakeMutex);
+			Wake.wait_for(Lock, std::chrono::milliseconds(10));
+			continue;
+		}
+
+		// Process message and release the slot
+		_ReplayWriterMessage &Slot = Queue[TailIndex % REPLAY_WRITER_QUEUE_SIZE];
+		Done = Slot.Type == MESSAGE_QUIT;
+		Process(Slot);
+		Slot.Data.clear();
+		Slot.Trailer.clear();
+		Tail.store(TailIndex + 1, std::memory_order_release);
+	}
+}
+
+// Handles one message on the writer thread
+void _ReplayWriter::Process(_ReplayWriterMessage &Message) {
+	switch(Message.Type) {
+		case MESSAGE_OPEN:
+			if(File.is_open())
+				File.close();
+
+			FilePath = Message.Path;
+			File.open(FilePath.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+			if(!File.is_open())
+				Log.Write("Unable to open: %s", FilePath.c_str());
+		break;
+		case MESSAGE_DATA:
+			if(File.is_open())
+				File.write(Message.Data.data(), (std::streamsize)Message.Data.size());
+		break;
+		case MESSAGE_REMOVE:
+			if(File.is_open()) {
+				File.close();
+				remove(FilePath.c_str());
+			}
+		break;
+		case MESSAGE_SAVE: {
+			std::vector<char> CompressedData;
+			if(!Compress(CompressedData, Message.Size)) {
+				Log.Write("Unable to compress replay data: %s", FilePath.c_str());
+				break;
+			}
+
+			// Write to a temporary file so a partial replay is never listed
+			std::string TempPath = Message.Path + ".tmp";
+			std::ofstream NewFile(TempPath.c_str(), std::ios::out | std::ios::binary);
+			if(!NewFile) {
+				Log.Write("Unable to open for writing: %s", TempPath.c_str());
+				break;
+			}
+
+			uint32_t CompressedSize = (uint32_t)CompressedData.size();
+			NewFile.write(Message.Data.data(), (std::streamsize)Message.Data.size());
+			NewFile.write((char *)&CompressedSize, sizeof(CompressedSize));
+			NewFile.write(CompressedData.data(), (std::streamsize)CompressedData.size());
+			NewFile.write(Message.Trailer.data(), (std::streamsize)Message.Trailer.size());
+			NewFile.close();
+
+			if(!NewFile || rename(TempPath.c_str(), Message.Path.c_str()) != 0) {
+				Log.Write("Unable to write replay: %s", Message.Path.c_str());
+				remove(TempPath.c_str());
+			}
+		} break;
+		case MESSAGE_QUIT:
+			if(File.is_open())
+				File.close();
+		break;
+	}
+}
+
+// Deflates the first Size bytes of the recording file
+bool _ReplayWriter::Compress(std::vector<char> &Output, size_t Size) {
+	if(!File.is_open())
+		return false;
+
+	File.flush();
+
+	z_stream ZStream;
+	std::memset(&ZStream, 0, sizeof(ZStream));
+	if(deflateInit(&ZStream, Z_BEST_COMPRESSION) != Z_OK)
+		return false;
+
+	// Deflate in blocks
+	std::ifstream CurrentReplayFile(FilePath.c_str(), std::ios::in | std::ios::binary);
+	char InBuffer[4096];
+	char OutBuffer[4096];
+	int Flush;
+	do {
+		size_t ReadSize = std::min(Size, sizeof(InBuffer));
+		CurrentReplayFile.read(InBuffer, (std::streamsize)ReadSize);
+		ZStream.avail_in = (uInt)CurrentReplayFile.gcount();
+		ZStream.next_in = (Bytef *)InBuffer;
+		Size -= ZStream.avail_in;
+		Flush = (CurrentReplayFile && Size) ? Z_NO_FLUSH : Z_FINISH;
+
+		// Append compressed output
+		do {
+			ZStream.avail_out = sizeof(OutBuffer);
+			ZStream.next_out = (Bytef *)OutBuffer;
+			deflate(&ZStream, Flush);
+
+			uint32_t OutSize = sizeof(OutBuffer) - ZStream.avail_out;
+			Output.insert(Output.end(), OutBuffer, OutBuffer + OutSize);
+		} while(ZStream.avail_out == 0);
+	} while(Flush != Z_FINISH);
+
+	deflateEnd(&ZStream);
+	CurrentReplayFile.close();
+
+	return true;
+}
@@ -0,0 +1,114 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <fstream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cstdint>
+
+// Constants
+const size_t REPLAY_WRITER_BLOCK_SIZE = 64 * 1024;
+const size_t REPLAY_WRITER_QUEUE_SIZE = 64;
+
+// Work item handed to the writer thread
+struct _ReplayWriterMessage {
+	_ReplayWriterMessage() : Type(0), Size(0) { }
+
+	int Type;
+	std::string Path;
+	std::vector<char> Data;
+	std::vector<char> Trailer;
+	size_t Size;
+};
+
+// Classes
+class _ReplayWriter {
+
+	public:
+
+		enum MessageType {
+			MESSAGE_OPEN,
+			MESSAGE_DATA,
+			MESSAGE_REMOVE,
+			MESSAGE_SAVE,
+			MESSAGE_QUIT,
+		};
+
+		_ReplayWriter() : Written(0), Head(0), Tail(0) { Buffer.reserve(REPLAY_WRITER_BLOCK_SIZE * 2); }
+
+		// Writer thread
+		void Start();
+		void Stop();
+
+		// Recording file
+		void Open(const std::string &Path);
+		void Remove();
+		void Save(const std::string &Path, std::vector<char> &Header, std::vector<char> &Trailer);
+
+		void Flush();
+		void Wait();
+		void FlushBlock() { if(Buffer.size() >= REPLAY_WRITER_BLOCK_SIZE) Flush(); }
+
+		// Append a value in its in-memory representation
+		template<typename T> void Put(const T &Value) { PutData(&Value, sizeof(T)); }
+		void PutData(const void *Data, size_t Size);
+		void PutVarint(int32_t Value);
+
+		size_t GetBufferedSize() const { return Buffer.size(); }
+		size_t GetOffset() const { return Written + Buffer.size(); }
+
+	private:
+
+		// Simulation thread side
+		void Submit(_ReplayWriterMessage &Message);
+		bool Pump();
+
+		// Writer thread side
+		void Run();
+		void Process(_ReplayWriterMessage &Message);
+		bool Compress(std::vector<char> &Output, size_t Size);
+
+		// Recording buffer
+		size_t Written;
+		std::vector<char> Buffer;
+		_ReplayWriterMessage DataMessage;
+
+		// Messages waiting for space in the queue
+		std::deque<_ReplayWriterMessage> Pending;
+
+		// Single producer, single consumer ring buffer
+		_ReplayWriterMessage Queue[REPLAY_WRITER_QUEUE_SIZE];
+		std::atomic<size_t> Head;
+		std::atomic<size_t> Tail;
+
+		// Writer thread
+		std::thread Thread;
+		std::mutex WakeMutex;
+		std::condition_variable Wake;
+		std::fstream File;
+		std::string FilePath;
+
+};
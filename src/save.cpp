@@ -20,7 +20,7 @@
 #include <log.h>
 #include <database.h>
 
-const int STATS_VERSION = 0;
+const int STATS_VERSION = 1;
 const int STATS_MAXSCORES = 10;
 
 #ifdef _WIN32
@@ -52,6 +52,16 @@ int _Save::Init() {
 	CustomLevelsPath = SavePath + std::string("customlevels/");
 	CachePath = SavePath + std::string("cache/");
 
+	// Get system temp directory
+	#ifdef _WIN32
+		char TempBuffer[MAX_PATH + 1];
+		DWORD TempLength = GetTempPathA(sizeof(TempBuffer), TempBuffer);
+		TempPath = TempLength && TempLength < sizeof(TempBuffer) ? std::string(TempBuffer, TempLength) : SavePath;
+	#else
+		const char *TempDirectory = getenv("TMPDIR");
+		TempPath = std::string(TempDirectory && TempDirectory[0] ? TempDirectory : "/tmp") + "/";
+	#endif
+
 	// Get files
 	ConfigFile = SavePath + std::string("config.xml");
 	StatsFile = SavePath + std::string("stats.dat");
@@ -92,12 +102,16 @@ int _Save::InitStatsDatabase() {
 	// Open stats database and get file version
 	if(Database->OpenDatabase(StatsFile.c_str())) {
 		int Result = Database->RunDataQuery("SELECT Version from DatabaseInfo");
-		if(Result)
+		if(Result && Database->FetchRow())
 			DatabaseVersion = Database->GetInt(0);
 		Database->CloseQuery();
 
 		// Upgrade old database versions
 		if(DatabaseVersion == 0) {
+			Database->RunQuery("BEGIN TRANSACTION");
+			CreateReplayIndex();
+			Database->RunQuery("UPDATE DatabaseInfo SET Version = 1");
+			Database->RunQuery("END TRANSACTION");
 		}
 	}
 
@@ -142,6 +156,9 @@ int _Save::InitStatsDatabase() {
 		// Create indexes
 		Database->RunQuery("CREATE INDEX StatsLevelFile on Stats (LevelFile ASC)");
 
+		// Create replay index table
+		CreateReplayIndex();
+
 		// Add version number
 		char Buffer[256];
 		sprintf(Buffer, "INSERT INTO DatabaseInfo(Version) VALUES(%d)", STATS_VERSION);
@@ -305,3 +322,84 @@ void _Save::UnlockLevel(const std::string &Level) {
 		Stats.ID = (int)Database->GetLastInsertID();
 	}
 }
+
+// Creates the table that caches replay headers
+void _Save::CreateReplayIndex() {
+	Database->RunQuery(
+		"CREATE TABLE IF NOT EXISTS Replays(\n"
+		"Filename TEXT PRIMARY KEY,\n"
+		"ModifiedTime INTEGER DEFAULT(0),\n"
+		"LevelFile TEXT,\n"
+		"Description TEXT,\n"
+		"ReplayVersion INTEGER,\n"
+		"LevelVersion INTEGER,\n"
+		"TimeStep FLOAT,\n"
+		"FinishTime FLOAT,\n"
+		"Date INTEGER,\n"
+		"Platform INTEGER,\n"
+		"Autosave INTEGER,\n"
+		"Won INTEGER\n"
+		")");
+}
+
+// Gets all indexed replays, sorted by date or by level then date
+void _Save::GetReplayIndex(std::vector<_ReplayIndex> &Replays, bool SortByLevel) {
+	Replays.clear();
+
+	// Get rows
+	Database->RunDataQuery(SortByLevel ? "SELECT * FROM Replays ORDER BY LevelFile ASC, Date DESC, Filename DESC" : "SELECT * FROM Replays ORDER BY Date DESC, Filename DESC");
+	while(Database->FetchRow()) {
+		_ReplayIndex Replay;
+		Replay.Filename = Database->GetString(0);
+		Replay.ModifiedTime = Database->GetInt(1);
+		Replay.LevelName = Database->GetString(2);
+		Replay.Description = Database->GetString(3);
+		Replay.ReplayVersion = Database->GetInt(4);
+		Replay.LevelVersion = Database->GetInt(5);
+		Replay.TimeStep = Database->GetFloat(6);
+		Replay.FinishTime = Database->GetFloat(7);
+		Replay.Timestamp = Database->GetInt(8);
+		Replay.Platform = (char)Database->GetInt(9);
+		Replay.Autosave = Database->GetInt(10);
+		Replay.Won = Database->GetInt(11);
+		Replays.push_back(Replay);
+	}
+	Database->CloseQuery();
+}
+
+// Adds or replaces changed replays and removes deleted ones from the index
+void _Save::UpdateReplayIndex(const std::vector<_ReplayIndex> &Changed, const std::vector<std::string> &Removed) {
+	if(!Changed.size() && !Removed.size())
+		return;
+
+	Database->RunQuery("BEGIN TRANSACTION");
+
+	// Insert new headers
+	for(const auto &Replay : Changed) {
+		char *Query = sqlite3_mprintf(
+			"INSERT OR REPLACE INTO Replays VALUES(%Q, %d, %Q, %Q, %d, %d, %.9g, %.9g, %d, %d, %d, %d)",
+			Replay.Filename.c_str(),
+			(int)Replay.ModifiedTime,
+			Replay.LevelName.c_str(),
+			Replay.Description.c_str(),
+			Replay.ReplayVersion,
+			Replay.LevelVersion,
+			Replay.TimeStep,
+			Replay.FinishTime,
+			(int)Replay.Timestamp,
+			(int)Replay.Platform,
+			(int)Replay.Autosave,
+			(int)Replay.Won);
+		Database->RunQuery(Query);
+		sqlite3_free(Query);
+	}
+
+	// Delete missing files
+	for(const auto &Filename : Removed) {
+		char *Query = sqlite3_mprintf("DELETE FROM Replays WHERE Filename = %Q", Filename.c_str());
+		Database->RunQuery(Query);
+		sqlite3_free(Query);
+	}
+
+	Database->RunQuery("END TRANSACTION");
+}
@@ -50,6 +50,24 @@ struct _LevelStat {
 	std::vector<_HighScore> HighScores;
 };
 
+// Struct for one replay header in the index
+struct _ReplayIndex {
+	_ReplayIndex() : ModifiedTime(0), ReplayVersion(0), LevelVersion(0), TimeStep(0), FinishTime(0), Timestamp(0), Platform(0), Autosave(false), Won(false) { }
+
+	std::string Filename;
+	time_t ModifiedTime;
+	std::string LevelName;
+	std::string Description;
+	int ReplayVersion;
+	int LevelVersion;
+	float TimeStep;
+	float FinishTime;
+	time_t Timestamp;
+	char Platform;
+	bool Autosave;
+	bool Won;
+};
+
 // Classes
 class _Save {
 
@@ -66,12 +84,17 @@ class _Save {
 		int AddScore(const std::string &Level, float Time);
 		void UnlockLevel(const std::string &Level);
 
+		// Replay index
+		void GetReplayIndex(std::vector<_ReplayIndex> &Replays, bool SortByLevel);
+		void UpdateReplayIndex(const std::vector<_ReplayIndex> &Changed, const std::vector<std::string> &Removed);
+
 		// Paths
 		std::string SavePath;
 		std::string ReplayPath;
 		std::string ScreenshotsPath;
 		std::string CustomLevelsPath;
 		std::string CachePath;
+		std::string TempPath;
 		std::string ConfigFile;
 		std::string StatsFile;
 
@@ -80,6 +103,8 @@ class _Save {
 
 	private:
 
+		void CreateReplayIndex();
+
 		// Database
 		_Database *Database;
 };
@@ -31,10 +31,13 @@
 #include <audio.h>
 #include <framework.h>
 #include <menu.h>
+#include <physics.h>
 #include <random>
+#include <type_traits>
 
 _Scripting Scripting;
 static std::mt19937 RandomGenerator(0);
+static_assert(std::is_trivially_copyable<std::mt19937>::value, "Random generator state is copied into physics snapshots");
 
 // Functions for audio
 luaL_Reg _Scripting::AudioFunctions[] = {
@@ -64,6 +67,7 @@ luaL_Reg _Scripting::LevelFunctions[] = {
 	{"Change", &_Scripting::LevelChange},
 	{"GetTemplate", &_Scripting::LevelGetTemplate},
 	{"CreateObject", &_Scripting::LevelCreateObject},
+	{"CreateObjects", &_Scripting::LevelCreateObjects},
 	{"CreateConstraint", &_Scripting::LevelCreateConstraint},
 	{nullptr, nullptr}
 };
@@ -150,6 +154,9 @@ int luaopen_Timer(lua_State *State) {
 	return 1;
 }
 
+// Marks a handler slot whose global isn't defined
+char _Scripting::EmptyHandler;
+
 // Constructor
 _Scripting::_Scripting() :
 	LuaObject(nullptr) {
@@ -199,9 +206,20 @@ void _Scripting::Reset() {
 	luaL_requiref(LuaObject, "Random", luaopen_Random, 1);
 	luaL_requiref(LuaObject, "Timer", luaopen_Timer, 1);
 
+	// Route missing globals through the handler slots
+	lua_pushglobaltable(LuaObject);
+	lua_newtable(LuaObject);
+	lua_pushcfunction(LuaObject, &_Scripting::GlobalsIndex);
+	lua_setfield(LuaObject, -2, "__index");
+	lua_pushcfunction(LuaObject, &_Scripting::GlobalsNewIndex);
+	lua_setfield(LuaObject, -2, "__newindex");
+	lua_setmetatable(LuaObject, -2);
+	lua_pop(LuaObject, 1);
+
 	// Clean up
 	KeyCallbacks.clear();
 	TimedCallbacks.clear();
+	FunctionReferences.clear();
 }
 
 // Loads a Lua file
@@ -244,43 +262,112 @@ bool _Scripting::CheckArguments(lua_State *LuaObject, int Required) {
 	return true;
 }
 
-// Calls a Lua function by name
-void _Scripting::CallFunction(const std::string &FunctionName) {
+// Returns the registry reference that holds a handler global. The first use of a name moves the global
+// into a registry slot, and assigning the global afterwards updates that slot, so every handler kind sees reassignments.
+int _Scripting::GetFunctionReference(const std::string &FunctionName) {
 
-	// Check for the function name
-	lua_getglobal(LuaObject, FunctionName.c_str());
-	if(!lua_isfunction(LuaObject, -1)) {
+	// Check cache
+	auto FunctionReferencesIterator = FunctionReferences.find(FunctionName);
+	if(FunctionReferencesIterator != FunctionReferences.end())
+		return FunctionReferencesIterator->second;
+
+	// Move the global into the registry, a name that isn't defined yet gets an empty slot that a later definition fills
+	lua_pushglobaltable(LuaObject);
+	lua_pushstring(LuaObject, FunctionName.c_str());
+	lua_rawget(LuaObject, -2);
+	if(lua_isnil(LuaObject, -1)) {
 		lua_pop(LuaObject, 1);
-		return;
+		lua_pushlightuserdata(LuaObject, &EmptyHandler);
 	}
+	int Reference = luaL_ref(LuaObject, LUA_REGISTRYINDEX);
+	FunctionReferences[FunctionName] = Reference;
 
-	lua_call(LuaObject, 0, 0);
+	// Remove it from the globals table so reads and writes go through the metamethods
+	lua_pushstring(LuaObject, FunctionName.c_str());
+	lua_pushnil(LuaObject);
+	lua_rawset(LuaObject, -3);
+	lua_pop(LuaObject, 1);
+
+	return Reference;
 }
 
-// Passes collision events to Lua
-void _Scripting::CallCollisionHandler(const std::string &FunctionName, _Object *BaseObject, _Object *OtherObject) {
+// Reads a global, handler names are read from their registry slot
+int _Scripting::GlobalsIndex(lua_State *LuaObject) {
+	if(lua_type(LuaObject, 2) == LUA_TSTRING) {
+		auto FunctionReferencesIterator = Scripting.FunctionReferences.find(lua_tostring(LuaObject, 2));
+		if(FunctionReferencesIterator != Scripting.FunctionReferences.end()) {
+			lua_rawgeti(LuaObject, LUA_REGISTRYINDEX, FunctionReferencesIterator->second);
+			if(lua_touserdata(LuaObject, -1) == &EmptyHandler)
+				lua_pushnil(LuaObject);
+
+			return 1;
+		}
+	}
 
-	// Check for the function name
-	lua_getglobal(LuaObject, FunctionName.c_str());
+	lua_pushnil(LuaObject);
+	return 1;
+}
+
+// Writes a new global, handler names are written to their registry slot
+int _Scripting::GlobalsNewIndex(lua_State *LuaObject) {
+	if(lua_type(LuaObject, 2) == LUA_TSTRING) {
+		auto FunctionReferencesIterator = Scripting.FunctionReferences.find(lua_tostring(LuaObject, 2));
+		if(FunctionReferencesIterator != Scripting.FunctionReferences.end()) {
+			if(lua_isnil(LuaObject, 3))
+				lua_pushlightuserdata(LuaObject, &EmptyHandler);
+			else
+				lua_pushvalue(LuaObject, 3);
+			lua_rawseti(LuaObject, LUA_REGISTRYINDEX, FunctionReferencesIterator->second);
+
+			return 0;
+		}
+	}
+
+	lua_rawset(LuaObject, 1);
+	return 0;
+}
+
+// Pushes the function held by a reference, returns false if the handler isn't a function
+bool _Scripting::PushFunction(int Reference) {
+	if(Reference == LUA_NOREF)
+		return false;
+
+	lua_rawgeti(LuaObject, LUA_REGISTRYINDEX, Reference);
 	if(!lua_isfunction(LuaObject, -1)) {
 		lua_pop(LuaObject, 1);
-		return;
+		return false;
 	}
 
+	return true;
+}
+
+// Calls a Lua function by name
+void _Scripting::CallFunction(const std::string &FunctionName) {
+	CallFunction(GetFunctionReference(FunctionName));
+}
+
+// Calls a Lua function by registry reference
+void _Scripting::CallFunction(int Reference) {
+	if(!PushFunction(Reference))
+		return;
+
+	lua_call(LuaObject, 0, 0);
+}
+
+// Passes collision events to Lua
+void _Scripting::CallCollisionHandler(int Reference, _Object *BaseObject, _Object *OtherObject) {
+	if(!PushFunction(Reference))
+		return;
+
 	lua_pushlightuserdata(LuaObject, BaseObject);
 	lua_pushlightuserdata(LuaObject, OtherObject);
 	lua_call(LuaObject, 2, 0);
 }
 
 // Calls a zone enter/exit event
-void _Scripting::CallZoneHandler(const std::string &FunctionName, int Type, _Object *Zone, _Object *Object) {
-
-	// Check for the function name
-	lua_getglobal(LuaObject, FunctionName.c_str());
-	if(!lua_isfunction(LuaObject, -1)) {
-		lua_pop(LuaObject, 1);
+void _Scripting::CallZoneHandler(int Reference, int Type, _Object *Zone, _Object *Object) {
+	if(!PushFunction(Reference))
 		return;
-	}
 
 	// Set parameters
 	lua_pushinteger(LuaObject, Type);
@@ -542,6 +629,47 @@ int _Scripting::LevelCreateObject(lua_State *LuaObject) {
 	return 1;
 }
 
+// Creates objects from a template at each position in a flat table of x, y, z values
+int _Scripting::LevelCreateObjects(lua_State *LuaObject) {
+
+	// Get argument count
+	int ArgumentCount = lua_gettop(LuaObject);
+
+	// Check for arguments
+	if((ArgumentCount != 3 && ArgumentCount != 4) || !lua_istable(LuaObject, 3) || (ArgumentCount == 4 && !lua_istable(LuaObject, 4))) {
+		Log.Write("Function Level.CreateObjects requires a name, template, position table and optional rotation table\n");
+		return 0;
+	}
+
+	// Get parameters
+	_ObjectSpawn Spawn;
+	Spawn.Name = lua_tostring(LuaObject, 1);
+	Spawn.Template = (_Template *)(lua_touserdata(LuaObject, 2));
+	int Count = (int)lua_rawlen(LuaObject, 3) / 3;
+	ObjectManager.ReserveObjects(Count);
+
+	// Create objects and return them in a table
+	lua_createtable(LuaObject, Count, 0);
+	for(int i = 0; i < Count; i++) {
+		for(int j = 0; j < 3; j++) {
+			lua_rawgeti(LuaObject, 3, i * 3 + j + 1);
+			Spawn.Position[j] = (float)lua_tonumber(LuaObject, -1);
+			lua_pop(LuaObject, 1);
+
+			if(ArgumentCount == 4) {
+				lua_rawgeti(LuaObject, 4, i * 3 + j + 1);
+				Spawn.Rotation[j] = (float)lua_tonumber(LuaObject, -1);
+				lua_pop(LuaObject, 1);
+			}
+		}
+
+		lua_pushlightuserdata(LuaObject, Level.CreateObject(Spawn));
+		lua_rawseti(LuaObject, -2, i + 1);
+	}
+
+	return 1;
+}
+
 // Gets a template from a name
 int _Scripting::LevelGetTemplate(lua_State *LuaObject) {
 
@@ -998,6 +1126,18 @@ void _Scripting::UpdateTimedCallbacks() {
 	}
 }
 
+// Saves the state of the random generator used by scripts
+void _Scripting::SaveRandomState(_PhysicsSnapshot &Snapshot) {
+	Snapshot.Put(RandomGenerator);
+}
+
+// Restores the random generator from a snapshot
+void _Scripting::LoadRandomState(_PhysicsSnapshot &Snapshot) {
+	const void *State = Snapshot.View(sizeof(RandomGenerator));
+	if(State)
+		std::memcpy(&RandomGenerator, State, sizeof(RandomGenerator));
+}
+
 // Attaches a key to a Lua function
 void _Scripting::AttachKeyToFunction(int Key, const std::string &FunctionName) {
 
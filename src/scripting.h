@@ -29,6 +29,7 @@ struct _TimedCallback {
 
 // Forward Declarations
 class _Object;
+class _PhysicsSnapshot;
 
 // Classes
 class _Scripting {
@@ -46,14 +47,19 @@ class _Scripting {
 
 		void DefineLuaVariable(const char *VariableName, const char *Value);
 
+		int GetFunctionReference(const std::string &FunctionName);
 		void CallFunction(const std::string &FunctionName);
-		void CallCollisionHandler(const std::string &FunctionName, _Object *BaseObject, _Object *OtherObject);
-		void CallZoneHandler(const std::string &FunctionName, int Type, _Object *Zone, _Object *Object);
+		void CallFunction(int Reference);
+		void CallCollisionHandler(int Reference, _Object *BaseObject, _Object *OtherObject);
+		void CallZoneHandler(int Reference, int Type, _Object *Zone, _Object *Object);
 
 		bool HandleKeyPress(int Key);
 		void HandleMousePress(int Button, int MouseX, int MouseY);
 		void UpdateTimedCallbacks();
 
+		void SaveRandomState(_PhysicsSnapshot &Snapshot);
+		void LoadRandomState(_PhysicsSnapshot &Snapshot);
+
 		static luaL_Reg CameraFunctions[], ObjectFunctions[], OrbFunctions[], TimerFunctions[], LevelFunctions[],
 						GUIFunctions[], AudioFunctions[], RandomFunctions[], ZoneFunctions[];
 
@@ -73,6 +79,7 @@ class _Scripting {
 		static int LevelChange(lua_State *LuaObject);
 		static int LevelCreateConstraint(lua_State *LuaObject);
 		static int LevelCreateObject(lua_State *LuaObject);
+		static int LevelCreateObjects(lua_State *LuaObject);
 		static int LevelGetTemplate(lua_State *LuaObject);
 		static int LevelLose(lua_State *LuaObject);
 		static int LevelWin(lua_State *LuaObject);
@@ -102,12 +109,18 @@ class _Scripting {
 		static int TimerCallback(lua_State *LuaObject);
 		static int TimerStamp(lua_State *LuaObject);
 
+		static int GlobalsIndex(lua_State *LuaObject);
+		static int GlobalsNewIndex(lua_State *LuaObject);
+		bool PushFunction(int Reference);
+
 		void AddTimedCallback(const std::string &FunctionName, float Time);
 		void AttachKeyToFunction(int Key, const std::string &FunctionName);
 
 		std::list<_TimedCallback> TimedCallbacks;
 
 		std::map<int, std::string> KeyCallbacks;
+		std::map<std::string, int> FunctionReferences;
+		static char EmptyHandler;
 
 		lua_State *LuaObject;
 
@@ -33,12 +33,14 @@
 #include <fader.h>
 #include <actions.h>
 #include <save.h>
+#include <profiler.h>
 #include <objects/player.h>
 #include <menu.h>
 #include <states/viewreplay.h>
 #include <states/null.h>
 #include <ISceneManager.h>
 #include <IFileSystem.h>
+#include <map>
 
 const float PAUSE_FADE_AMOUNT = 0.85f;
 
@@ -81,7 +83,11 @@ int _PlayState::Init() {
 		Save.UnlockLevel(LevelFile);
 	}
 
+	// Start physics, resets only recreate the world
+	Physics.Init();
+
 	// Load level
+	LevelSnapshot.Clear();
 	if(!Level.Init(LevelFile))
 		return 0;
 
@@ -130,6 +136,9 @@ void _PlayState::ResetLevel() {
 	HighScoreIndex = -1;
 	FirstLoad = false;
 	Jumped = false;
+	InputRecorded = false;
+	SpeedRecorded = false;
+	HasReplayInput = false;
 
 	// Handle saves
 	if(TestLevel == "") {
@@ -145,6 +154,10 @@ void _PlayState::ResetLevel() {
 		InputReplay->ReadEvent(NextEvent);
 	}
 
+	// Reset desync detection
+	HashPending = false;
+	Desynced = false;
+
 	// Stop sounds
 	Audio.StopSounds();
 
@@ -161,16 +174,40 @@ void _PlayState::ResetLevel() {
 	Camera->SetDistance(5.0f);
 	Camera->SetFOV(Config.FOV);
 
-	// Clear objects
-	ObjectManager.ClearObjects();
-	Physics.Reset();
+	// Put the level back to its spawned state unless a level object has been deleted since. Input replays are always
+	// simulated from a fresh load, like they are when validated. A failed restore may leave objects partly restored, so
+	// the level is cleared and spawned again.
+	bool Restored = !ReplayInputs && !LevelSnapshot.IsEmpty() && Physics.Restore(LevelSnapshot);
+	if(!Restored) {
+
+		// Clear objects, keeping static level geometry to be added back by SpawnEntities
+		ObjectManager.ClearObjects(true);
+		Physics.Reset();
+	}
+
+	// Recycled bodies change the order ODE steps them in, so older replays are simulated without pooling
+	ObjectManager.SetPooling(!ReplayInputs || InputReplay->GetVersion() >= 8);
+
+	// Older replays collide against terrain built as a trimesh
+	Physics.SetHeightfieldTerrain(!ReplayInputs || InputReplay->GetVersion() >= 9);
 
-	// Start replay recording
-	Replay.StartRecording();
+	// Start replay recording, except for headless validation which may run in parallel
+	if(!(ReplayInputs && Framework.IsSimulating()))
+		Replay.StartRecording();
 
 	// Load level objects
-	Level.SpawnEntities();
+	if(Restored)
+		Level.RecordSpawnEvents();
+	else {
+		Level.SpawnEntities();
+		if(!ReplayInputs)
+			Physics.Snapshot(LevelSnapshot);
+	}
 	Level.RunScripts();
+
+	// Fit the static quadtree after the scripts, so static objects they spawn are inside it
+	if(!Restored)
+		Physics.BuildStaticSpace();
 	Graphics.SetLightCount();
 
 	// Get the player
@@ -296,6 +333,12 @@ bool _PlayState::HandleKeyPress(int Key) {
 				else
 					Player->PrintOrientation();
 			break;
+			case KEY_F4:
+				if(Input.GetKeyState(KEY_RSHIFT))
+					Profiler.SaveCSV();
+				else
+					Profiler.Visible = !Profiler.Visible;
+			break;
 			case KEY_F5:
 				Framework.ChangeState(&PlayState);
 			break;
@@ -382,12 +425,21 @@ void _PlayState::Update(float FrameTime) {
 
 		// Update physics
 		Physics.Update(FrameTime);
-		ObjectManager.Update(FrameTime);
+		{
+			_ProfilerScope Scope(_Profiler::SECTION_OBJECTS);
+			ObjectManager.Update(FrameTime);
+		}
 		Interface.Update(FrameTime);
-		Scripting.UpdateTimedCallbacks();
+		{
+			_ProfilerScope Scope(_Profiler::SECTION_SCRIPTS);
+			Scripting.UpdateTimedCallbacks();
+		}
 
 		// Handle end of updates
-		ObjectManager.EndFrame();
+		{
+			_ProfilerScope Scope(_Profiler::SECTION_OBJECTS);
+			ObjectManager.EndFrame();
+		}
 
 		// Update audio
 		glm::vec3 Position = Player->GetPosition();
@@ -395,11 +447,18 @@ void _PlayState::Update(float FrameTime) {
 
 		// Update camera for replay
 		Camera->Update(core::vector3df(Position[0], Position[1], Position[2]));
-		Camera->RecordReplay();
 
 		// Record state for replay
-		RecordPlayerSpeed();
-		RecordInput();
+		{
+			_ProfilerScope Scope(_Profiler::SECTION_REPLAY);
+			Camera->RecordReplay();
+			RecordPlayerSpeed();
+			RecordInput();
+			RecordKeyframe();
+		}
+
+		// Compare against the recorded world hash
+		CheckHash();
 
 		// Reset jump state
 		Jumped = false;
@@ -428,6 +487,10 @@ void _PlayState::Draw() {
 	if(Config.ShowFPS)
 		Interface.RenderFPS(irrDriver->getScreenSize().Width - 140 * Interface.GetUIScale(), 10 * Interface.GetUIScale());
 
+	// Draw profiler
+	if(Profiler.Visible)
+		Interface.RenderProfiler(irrDriver->getScreenSize().Width - 280 * Interface.GetUIScale(), 40 * Interface.GetUIScale());
+
 	// Darken the screen
 	if(IsPaused())
 		Interface.FadeScreen(PAUSE_FADE_AMOUNT);
@@ -517,14 +580,23 @@ void _PlayState::RecordInput() {
 	float Yaw = Camera->GetYaw();
 	float Pitch = Camera->GetPitch();
 
+	// Skip unchanged input
+	if(InputRecorded && !Jumped && Push.X == RecordedPush.X && Push.Z == RecordedPush.Z && Yaw == RecordedYaw && Pitch == RecordedPitch)
+		return;
+
+	InputRecorded = true;
+	RecordedPush = Push;
+	RecordedYaw = Yaw;
+	RecordedPitch = Pitch;
+
 	// Write replay event
-	std::fstream &ReplayFile = Replay.GetFile();
+	_ReplayWriter &ReplayWriter = Replay.GetWriter();
 	Replay.WriteEvent(_Replay::PACKET_INPUT);
-	ReplayFile.write((char *)&Push.X, sizeof(Push.X));
-	ReplayFile.write((char *)&Push.Z, sizeof(Push.Z));
-	ReplayFile.write((char *)&Yaw, sizeof(Yaw));
-	ReplayFile.write((char *)&Pitch, sizeof(Pitch));
-	ReplayFile.write((char *)&Jumped, sizeof(Jumped));
+	ReplayWriter.Put(Push.X);
+	ReplayWriter.Put(Push.Z);
+	ReplayWriter.Put(Yaw);
+	ReplayWriter.Put(Pitch);
+	ReplayWriter.Put(Jumped);
 }
 
 // Record player speed to replay
@@ -535,10 +607,34 @@ void _PlayState::RecordPlayerSpeed() {
 	// Get speed
 	float Speed = glm::length(Player->GetLinearVelocity()) + glm::length(Player->GetAngularVelocity());
 
+	// Skip unchanged speed
+	if(SpeedRecorded && Speed == RecordedSpeed)
+		return;
+
+	SpeedRecorded = true;
+	RecordedSpeed = Speed;
+
 	// Write replay event
-	std::fstream &ReplayFile = Replay.GetFile();
 	Replay.WriteEvent(_Replay::PACKET_PLAYERSPEED);
-	ReplayFile.write((char *)&Speed, sizeof(Speed));
+	Replay.GetWriter().Put(Speed);
+}
+
+// Record full state and a world hash periodically so replays can be seeked and checked for desyncs
+void _PlayState::RecordKeyframe() {
+	if(!Replay.NeedsKeyframe())
+		return;
+
+	// Write camera
+	_ReplayWriter &ReplayWriter = Replay.GetWriter();
+	Replay.StartKeyframe();
+	ReplayWriter.Put(Camera->GetNode()->getPosition());
+	ReplayWriter.Put(Camera->GetNode()->getTarget());
+
+	// Write objects
+	ObjectManager.WriteKeyframe();
+
+	// Write world hash
+	ObjectManager.WriteHash();
 }
 
 // Control game from replay inputs
@@ -546,72 +642,98 @@ void _PlayState::GetInputFromReplay() {
 	if(!ReplayInputs)
 		return;
 
-	char Buffer[1024];
-	std::fstream &ReplayFile = InputReplay->GetFile();
+	bool InputRead = false;
+	_ReplayReader &ReplayReader = InputReplay->GetReader();
 	while(!InputReplay->ReplayStopped() && Timer >= NextEvent.Timestamp) {
 		//printf("Processing header packet: type=%d time=%f\n", NextEvent.Type, NextEvent.Timestamp);
 
 		switch(NextEvent.Type) {
-			case _Replay::PACKET_MOVEMENT: {
-				int16_t ObjectCount;
-				ReplayFile.read((char *)&ObjectCount, sizeof(ObjectCount));
-				for(int i = 0; i < ObjectCount; i++)
-					ReplayFile.read(Buffer, 2 + 4 * 3 + 4 * 3);
-			} break;
-			case _Replay::PACKET_CREATE: {
-				ReplayFile.read(Buffer, 2 + 2);
-				int PositionType = ReplayFile.get();
-				if(PositionType == 1)
-					ReplayFile.read(Buffer, 4 * 4);
-				else
-					ReplayFile.read(Buffer, 4 * 3);
-				ReplayFile.read(Buffer, 4 * 3);
-			} break;
-			case _Replay::PACKET_DELETE:
-				ReplayFile.read(Buffer, 2);
-			break;
-			case _Replay::PACKET_CAMERA:
-				ReplayFile.read(Buffer, 4 * 3 + 4 * 3);
-			break;
-			case _Replay::PACKET_ORBDEACTIVATE:
-				ReplayFile.read(Buffer, 2 + 4);
-			break;
 			case _Replay::PACKET_INPUT: {
 
 				// Read replay
-				core::vector3df Push(0.0f, 0.0f, 0.0f);
-				bool Jumping;
-				float Yaw;
-				float Pitch;
-				ReplayFile.read((char *)&Push.X, sizeof(Push.X));
-				ReplayFile.read((char *)&Push.Z, sizeof(Push.Z));
-				ReplayFile.read((char *)&Yaw, sizeof(Yaw));
-				ReplayFile.read((char *)&Pitch, sizeof(Pitch));
-				ReplayFile.read((char *)&Jumping, sizeof(Jumping));
+				const _ReplayInputData *Data = ReplayReader.View<_ReplayInputData>();
+				ReplayPush.set(Data->PushX, 0.0f, Data->PushZ);
+				ReplayYaw = Data->Yaw;
+				ReplayPitch = Data->Pitch;
+				HasReplayInput = true;
+				InputRead = true;
 
 				// Inject input
-				Camera->SetYaw(Yaw);
-				Camera->SetPitch(Pitch);
+				Camera->SetYaw(ReplayYaw);
+				Camera->SetPitch(ReplayPitch);
+				core::vector3df Push = ReplayPush;
 				Player->HandlePush(Push);
-				if(Jumping)
+				if(Data->Jumped)
 					Player->Jump();
 
-				//printf("t=%f x=%f z=%f yaw=%f pitch=%f jumping=%d\n", NextEvent.Timestamp, Push.X, Push.Z, Yaw, Pitch, Jumping);
+				//printf("t=%f x=%f z=%f yaw=%f pitch=%f jumping=%d\n", NextEvent.Timestamp, ReplayPush.X, ReplayPush.Z, ReplayYaw, ReplayPitch, Data->Jumped);
 			}
 			break;
-			case _Replay::PACKET_PLAYERSPEED:
-				ReplayFile.read(Buffer, 4);
-			break;
+			case _Replay::PACKET_HASH: {
+				ExpectedHash = ReplayReader.Get<uint32_t>();
+				ExpectedObjectHashes.resize(ReplayReader.Get<uint16_t>());
+				for(auto &ObjectHash : ExpectedObjectHashes)
+					ReplayReader.Get(ObjectHash);
+				HashPending = true;
+			} break;
 			default:
+				InputReplay->SkipPacket(NextEvent.Type);
 			break;
 		}
 
 		InputReplay->ReadEvent(NextEvent);
 	}
 
+	// Unchanged input isn't recorded, so keep applying the last one
+	if(!InputRead && HasReplayInput) {
+		Camera->SetYaw(ReplayYaw);
+		Camera->SetPitch(ReplayPitch);
+		core::vector3df Push = ReplayPush;
+		Player->HandlePush(Push);
+	}
+
 	if(InputReplay->ReplayStopped()) {
 		Log.Write("Validation stopped %fs", PlayState.Timer);
 
 		Menu.InitPause();
 	}
 }
+
+// Compares the world state to the hash recorded at the end of this step
+void _PlayState::CheckHash() {
+	if(!HashPending)
+		return;
+
+	HashPending = false;
+	if(Desynced)
+		return;
+
+	std::vector<_ReplayObjectHash> ObjectHashes;
+	if(ObjectManager.GetStateHash(ObjectHashes) == ExpectedHash)
+		return;
+
+	// Only the first desync is reported
+	Desynced = true;
+	Log.Write("Desync at step %d, time=%fs", (int)(Timer / Framework.GetTimeStep() + 0.5f), Timer);
+
+	// Report objects that differ
+	std::map<uint16_t, uint16_t> Expected;
+	for(const auto &ObjectHash : ExpectedObjectHashes)
+		Expected[ObjectHash.ObjectID] = ObjectHash.Hash;
+
+	for(const auto &ObjectHash : ObjectHashes) {
+		_Object *Object = ObjectManager.GetObjectByID(ObjectHash.ObjectID);
+		auto Iterator = Expected.find(ObjectHash.ObjectID);
+		if(Iterator == Expected.end())
+			Log.Write("Desync object %d (%s) is not in replay", ObjectHash.ObjectID, Object->GetName().c_str());
+		else {
+			if(Iterator->second != ObjectHash.Hash)
+				Log.Write("Desync object %d (%s) differs", ObjectHash.ObjectID, Object->GetName().c_str());
+
+			Expected.erase(Iterator);
+		}
+	}
+
+	for(const auto &Iterator : Expected)
+		Log.Write("Desync object %d is missing", Iterator.first);
+}
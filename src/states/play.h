@@ -20,7 +20,10 @@
 // Libraries
 #include <state.h>
 #include <replay.h>
+#include <physics.h>
+#include <vector3d.h>
 #include <string>
+#include <vector>
 
 // Forward Declarations
 class _Object;
@@ -62,13 +65,16 @@ class _PlayState : public _State {
 
 		_Camera *GetCamera() { return Camera; }
 		float GetTimer() { return Timer; }
+		void SetTimer(float Value) { Timer = Value; }
 
 	private:
 
 		// Replays
 		void RecordInput();
 		void RecordPlayerSpeed();
+		void RecordKeyframe();
 		void GetInputFromReplay();
+		void CheckHash();
 
 		// States
 		std::string TestLevel;
@@ -85,11 +91,29 @@ class _PlayState : public _State {
 		_Player *Player;
 		_Camera *Camera;
 
+		// Level state right after spawning, restored on reset instead of spawning again
+		_PhysicsSnapshot LevelSnapshot;
+
 		// Replays
 		std::string InputReplayFilename;
 		bool ReplayInputs;
 		_Replay *InputReplay;
 		_ReplayEvent NextEvent;
+
+		// Last recorded input, unchanged values aren't written again
+		irr::core::vector3df RecordedPush;
+		float RecordedYaw, RecordedPitch, RecordedSpeed;
+		bool InputRecorded, SpeedRecorded;
+
+		// Input read from replay, applied every step
+		irr::core::vector3df ReplayPush;
+		float ReplayYaw, ReplayPitch;
+		bool HasReplayInput;
+
+		// World hash read from replay, checked after the step that recorded it
+		std::vector<_ReplayObjectHash> ExpectedObjectHashes;
+		uint32_t ExpectedHash;
+		bool HashPending, Desynced;
 };
 
 extern _PlayState PlayState;
@@ -28,6 +28,7 @@
 #include <audio.h>
 #include <framework.h>
 #include <interface.h>
+#include <profiler.h>
 #include <objects/orb.h>
 #include <objects/player.h>
 #include <objects/template.h>
@@ -36,6 +37,7 @@
 #include <menu.h>
 #include <states/null.h>
 #include <ISceneManager.h>
+#include <algorithm>
 
 const float REPLAY_TIME_INCREMENT = 0.1f;
 
@@ -51,6 +53,9 @@ int _ViewReplayState::Init() {
 	Camera = nullptr;
 	Player = nullptr;
 	FreeCamera = false;
+	Scrubbing = false;
+	CameraPending = false;
+	SeekSnapshot.Clear();
 
 	// Set up state
 	PauseSpeed = 1.0f;
@@ -121,6 +126,12 @@ bool _ViewReplayState::HandleKeyPress(int Key) {
 			NullState.State = _Menu::STATE_REPLAYS;
 			Framework.ChangeState(&NullState);
 		break;
+		case KEY_F4:
+			if(Input.GetKeyState(KEY_RSHIFT))
+				Profiler.SaveCSV();
+			else
+				Profiler.Visible = !Profiler.Visible;
+		break;
 		case KEY_F11:
 			ShowHUD = !ShowHUD;
 		break;
@@ -130,9 +141,15 @@ bool _ViewReplayState::HandleKeyPress(int Key) {
 		case KEY_SPACE:
 			Pause();
 		break;
+		case KEY_LEFT:
+			Skip(-1.0f);
+		break;
 		case KEY_RIGHT:
 			Skip(1.0f);
 		break;
+		case KEY_HOME:
+			SeekTo(0.0f);
+		break;
 		case KEY_KEY_1:
 			Framework.SetTimeScale(0.5);
 		break;
@@ -171,6 +188,13 @@ bool _ViewReplayState::HandleMousePress(int Button, int MouseX, int MouseY) {
 		Input.SetMouseLocked(true);
 	}
 
+	// LMB on the timeline starts scrubbing
+	if(Button == 0 && ShowHUD && GetTimelineBounds().isPointInside(core::position2di(MouseX, MouseY))) {
+		Scrubbing = true;
+		SeekTo(GetTimelinePosition((float)MouseX));
+		return true;
+	}
+
 	return false;
 }
 
@@ -180,6 +204,8 @@ void _ViewReplayState::HandleMouseLift(int Button, int MouseX, int MouseY) {
 		FreeCamera = false;
 		Input.SetMouseLocked(false);
 	}
+	else if(Button == 0)
+		Scrubbing = false;
 }
 
 // Handle action inputs
@@ -251,7 +277,7 @@ void _ViewReplayState::HandleGUI(irr::gui::EGUI_EVENT_TYPE EventType, gui::IGUIE
 					Pause();
 				break;
 				case MAIN_RESTART:
-					Framework.ChangeState(this);
+					SeekTo(0.0f);
 				break;
 				case MAIN_SKIP:
 					Skip(1.0f);
@@ -266,8 +292,35 @@ void _ViewReplayState::HandleGUI(irr::gui::EGUI_EVENT_TYPE EventType, gui::IGUIE
 // Updates the current state
 void _ViewReplayState::Update(float FrameTime) {
 
+	// Timeline controls the time while scrubbing
+	if(Scrubbing)
+		return;
+
 	// Update the replay
 	Timer += FrameTime;
+	ProcessEvents();
+
+	ObjectManager.UpdateReplay(FrameTime);
+	Interface.Update(FrameTime);
+}
+
+// Move scene nodes once per rendered frame
+void _ViewReplayState::UpdateRender(float BlendFactor) {
+	ApplyPendingUpdates();
+}
+
+// Apply the last movement and camera packets read since the previous frame
+void _ViewReplayState::ApplyPendingUpdates() {
+	ObjectManager.ApplyReplayOrientations();
+
+	if(CameraPending) {
+		CameraPending = false;
+		SetCamera(PendingCameraPosition, PendingCameraTarget);
+	}
+}
+
+// Process replay events up to the current time
+void _ViewReplayState::ProcessEvents() {
 	while(!Replay.ReplayStopped() && Timer >= NextEvent.Timestamp) {
 		//printf("Processing header packet: type=%d time=%f\n", NextEvent.Type, NextEvent.Timestamp);
 
@@ -279,29 +332,26 @@ void _ViewReplayState::Update(float FrameTime) {
 				_ObjectSpawn Spawn;
 
 				// Read replay
-				std::fstream &ReplayFile = Replay.GetFile();
+				_ReplayReader &ReplayReader = Replay.GetReader();
+				const _ReplayCreateData *Data = ReplayReader.View<_ReplayCreateData>();
 
 				// Get template
-				int16_t TemplateID;
-				ReplayFile.read((char *)&TemplateID, sizeof(TemplateID));
-				Spawn.Template = Level.GetTemplateFromID(TemplateID);
+				Spawn.Template = Level.GetTemplateFromID(Data->TemplateID);
 
-				// Get object id
-				int16_t ObjectID;
-				ReplayFile.read((char *)&ObjectID, sizeof(ObjectID));
+				// Get object id, ids are unsigned once they pass 32767
+				uint16_t ObjectID = (uint16_t)Data->ObjectID;
 
 				// Get orientation
-				int PositionType = ReplayFile.get();
-				if(PositionType == 1)
-					ReplayFile.read((char *)&Spawn.Plane, sizeof(float) * 4);
+				if(Data->PositionType == 1)
+					ReplayReader.GetData(&Spawn.Plane, sizeof(float) * 4);
 				else
-					ReplayFile.read((char *)&Spawn.Position, sizeof(float) * 3);
-				ReplayFile.read((char *)&Spawn.Rotation, sizeof(float) * 3);
+					ReplayReader.GetData(&Spawn.Position, sizeof(float) * 3);
+				ReplayReader.GetData(&Spawn.Rotation, sizeof(float) * 3);
 
 				// Create spawn object
 				if(Spawn.Template != nullptr) {
 					_Object *NewObject = Level.CreateObject(Spawn);
-					NewObject->SetID(ObjectID);
+					ObjectManager.ChangeObjectID(NewObject, ObjectID);
 
 					// Get player
 					if(NewObject->GetType() == _Object::PLAYER)
@@ -315,101 +365,168 @@ void _ViewReplayState::Update(float FrameTime) {
 			case _Replay::PACKET_DELETE: {
 
 				// Read replay
-				std::fstream &ReplayFile = Replay.GetFile();
-				int16_t ObjectID;
-				ReplayFile.read((char *)&ObjectID, sizeof(ObjectID));
+				const _ReplayDeleteData *Data = Replay.GetReader().View<_ReplayDeleteData>();
 
 				// Delete object
-				ObjectManager.DeleteObjectByID(ObjectID);
+				ObjectManager.DeleteObjectByID((uint16_t)Data->ObjectID);
 			}
 			break;
 			case _Replay::PACKET_CAMERA: {
 
-				// Read replay
-				core::vector3df Position, LookAt;
-				std::fstream &ReplayFile = Replay.GetFile();
-				ReplayFile.read((char *)&Position.X, sizeof(float) * 3);
-				ReplayFile.read((char *)&LookAt.X, sizeof(float) * 3);
-
-				// Update audio
-				Audio.SetPosition(LookAt.X, LookAt.Y, LookAt.Z);
-
-				// Set camera orientation
-				if(!FreeCamera) {
-					Camera->GetNode()->setPosition(Position);
-					Camera->GetNode()->setTarget(LookAt);
-
-					// Set yaw and pitch of free camera
-					core::vector3df Direction = (Position - LookAt).normalize();
-					Camera->SetYaw(-std::atan2(Direction.X, -Direction.Z) * core::RADTODEG);
-					Camera->SetPitch(std::asin(Direction.Y) * core::RADTODEG);
-				}
-				Graphics.SetDrawScene(true);
-
-				//printf("Camera Position=%f %f %f Target=%f %f %f\n", Position.X, Position.Y, Position.Z, LookAt.X, LookAt.Y, LookAt.Z);
+				// Read replay, only the last camera before a frame is drawn is used
+				const _ReplayCameraData *Data = Replay.GetReader().View<_ReplayCameraData>();
+				PendingCameraPosition.set(Data->Position[0], Data->Position[1], Data->Position[2]);
+				PendingCameraTarget.set(Data->Target[0], Data->Target[1], Data->Target[2]);
+				CameraPending = true;
 			}
 			break;
 			case _Replay::PACKET_ORBDEACTIVATE: {
 
 				// Read replay
-				std::fstream &ReplayFile = Replay.GetFile();
-				int16_t ObjectID;
-				float Length;
-				ReplayFile.read((char *)&ObjectID, sizeof(ObjectID));
-				ReplayFile.read((char *)&Length, sizeof(Length));
+				const _ReplayOrbDeactivateData *Data = Replay.GetReader().View<_ReplayOrbDeactivateData>();
 
 				// Deactivate orb
-				_Orb *Orb = static_cast<_Orb *>(ObjectManager.GetObjectByID(ObjectID));
-				Orb->StartDeactivation("", Length);
+				_Orb *Orb = static_cast<_Orb *>(ObjectManager.GetObjectByID(Data->ObjectID));
+				Orb->StartDeactivation("", Data->Length);
 
 				// Update number of lights
 				Graphics.SetLightCount();
 			}
 			break;
-			case _Replay::PACKET_INPUT: {
-				core::vector3df Push(0.0f, 0.0f, 0.0f);
-				bool Jumping;
-				float Yaw;
-				float Pitch;
-
-				// Read replay
-				std::fstream &ReplayFile = Replay.GetFile();
-				ReplayFile.read((char *)&Push.X, sizeof(Push.X));
-				ReplayFile.read((char *)&Push.Z, sizeof(Push.Z));
-				ReplayFile.read((char *)&Yaw, sizeof(Yaw));
-				ReplayFile.read((char *)&Pitch, sizeof(Pitch));
-				ReplayFile.read((char *)&Jumping, sizeof(Jumping));
-
-				//printf("x=%f z=%f yaw=%f pitch=%f jumping=%d\n", Push.X, Push.Z, Yaw, Pitch, Jumping);
-			}
-			break;
 			case _Replay::PACKET_PLAYERSPEED: {
 
 				// Read replay
-				float Speed;
-				std::fstream &ReplayFile = Replay.GetFile();
-				ReplayFile.read((char *)&Speed, sizeof(Speed));
+				const _ReplayPlayerSpeedData *Data = Replay.GetReader().View<_ReplayPlayerSpeedData>();
 
 				// Update player audio
 				if(Player) {
-					core::vector3df Position = Player->GetNode()->getPosition();
-					Player->UpdateAudio(glm::vec3(Position.X, Position.Y, Position.Z), Speed);
+					core::vector3df Position = Player->GetReplayPosition();
+					Player->UpdateAudio(glm::vec3(Position.X, Position.Y, Position.Z), Data->Speed);
 				}
 			}
 			break;
+			case _Replay::PACKET_KEYFRAME:
+				ReadKeyframe(false);
+			break;
 			default:
+
+				// Input and hashes only drive validation
+				Replay.SkipPacket(NextEvent.Type);
 			break;
 		}
 
 		Replay.ReadEvent(NextEvent);
 	}
+}
 
-	ObjectManager.UpdateReplay(FrameTime);
-	Interface.Update(FrameTime);
+// Reads a keyframe packet, optionally rebuilding the scene from it
+void _ViewReplayState::ReadKeyframe(bool Apply) {
+	_ReplayReader &ReplayReader = Replay.GetReader();
+
+	// Read camera
+	const _ReplayCameraData *CameraData = ReplayReader.View<_ReplayCameraData>();
+	core::vector3df Position(CameraData->Position[0], CameraData->Position[1], CameraData->Position[2]);
+	core::vector3df LookAt(CameraData->Target[0], CameraData->Target[1], CameraData->Target[2]);
+
+	// Skip object data during normal playback
+	int16_t ObjectCount = ReplayReader.Get<int16_t>();
+	if(!Apply) {
+		ReplayReader.Skip(ObjectCount * sizeof(_ReplayKeyframeObjectData));
+
+		// Movement after a keyframe isn't delta encoded against earlier samples
+		for(auto &Iterator : ObjectManager.GetObjects())
+			Iterator->GetReplayBase().Reset();
+
+		SaveSeekSnapshot(Position, LookAt);
+		return;
+	}
+
+	CameraPending = false;
+	SetCamera(Position, LookAt);
+
+	// Create objects
+	for(int i = 0; i < ObjectCount; i++) {
+		const _ReplayKeyframeObjectData *Data = ReplayReader.View<_ReplayKeyframeObjectData>();
+
+		// Get spawn information
+		_ObjectSpawn Spawn;
+		Spawn.Template = Level.GetTemplateFromID(Data->TemplateID);
+		if(Spawn.Template == nullptr)
+			continue;
+
+		if(Data->PositionType == 1)
+			Spawn.Plane = glm::vec4(Data->Orientation[0], Data->Orientation[1], Data->Orientation[2], Data->Orientation[3]);
+		else
+			Spawn.Position = glm::vec3(Data->Orientation[0], Data->Orientation[1], Data->Orientation[2]);
+		Spawn.Rotation = glm::vec3(Data->Rotation[0], Data->Rotation[1], Data->Rotation[2]);
+
+		// Create object
+		_Object *NewObject = Level.CreateObject(Spawn);
+		if(!NewObject)
+			continue;
+
+		ObjectManager.ChangeObjectID(NewObject, Data->ObjectID);
+		if(NewObject->GetType() == _Object::PLAYER)
+			Player = (_Player *)NewObject;
+		else if(NewObject->GetType() == _Object::ORB)
+			static_cast<_Orb *>(NewObject)->SetStateFromReplay(Data->OrbState, Data->OrbTime, Data->DeactivateLength);
+	}
+
+	SaveSeekSnapshot(Position, LookAt);
+}
+
+// Save the scene as it is at the keyframe just read
+void _ViewReplayState::SaveSeekSnapshot(const core::vector3df &CameraPosition, const core::vector3df &CameraTarget) {
+	Physics.Snapshot(SeekSnapshot);
+	SeekSnapshotTime = NextEvent.Timestamp;
+	SeekSnapshotOffset = (uint32_t)Replay.GetReader().GetOffset();
+	SeekCameraPosition = CameraPosition;
+	SeekCameraTarget = CameraTarget;
+}
+
+// Restore the scene saved at a keyframe if it's the closest starting point for a seek
+bool _ViewReplayState::LoadSeekSnapshot(float Time, float KeyframeTime) {
+	if(SeekSnapshot.IsEmpty() || SeekSnapshotTime > Time || SeekSnapshotTime < KeyframeTime)
+		return false;
+
+	// Fails if an object has been deleted since, the caller then rebuilds the scene from a keyframe
+	if(!Physics.Restore(SeekSnapshot))
+		return false;
+
+	Player = static_cast<_Player *>(ObjectManager.GetObjectByType(_Object::PLAYER));
+	Replay.SeekData(SeekSnapshotOffset);
+	CameraPending = false;
+	SetCamera(SeekCameraPosition, SeekCameraTarget);
+
+	return true;
+}
+
+// Sets the camera from replay data
+void _ViewReplayState::SetCamera(const core::vector3df &Position, const core::vector3df &LookAt) {
+
+	// Update audio
+	Audio.SetPosition(LookAt.X, LookAt.Y, LookAt.Z);
+
+	// Set camera orientation
+	if(!FreeCamera) {
+		Camera->GetNode()->setPosition(Position);
+		Camera->GetNode()->setTarget(LookAt);
+
+		// Set yaw and pitch of free camera
+		core::vector3df Direction = (Position - LookAt).normalize();
+		Camera->SetYaw(-std::atan2(Direction.X, -Direction.Z) * core::RADTODEG);
+		Camera->SetPitch(std::asin(Direction.Y) * core::RADTODEG);
+	}
+	Graphics.SetDrawScene(true);
 }
 
 // Draws the current state
 void _ViewReplayState::Draw() {
+
+	// Follow the mouse while scrubbing, also works when paused
+	if(Scrubbing)
+		SeekTo(GetTimelinePosition(Input.GetMouseX()));
+
 	if(FreeCamera && Player)
 		Camera->Update(Player->GetNode()->getPosition());
 
@@ -449,6 +566,19 @@ void _ViewReplayState::Draw() {
 	if(Config.ShowFPS)
 		Interface.RenderFPS(10 * Interface.GetUIScale(), irrDriver->getScreenSize().Height - 50 * Interface.GetUIScale());
 
+	// Draw profiler
+	if(Profiler.Visible)
+		Interface.RenderProfiler(10 * Interface.GetUIScale(), 10 * Interface.GetUIScale());
+
+	// Draw timeline
+	core::recti Timeline = GetTimelineBounds();
+	irrDriver->draw2DRectangle(video::SColor(100, 0, 0, 0), Timeline);
+	if(Replay.GetFinishTime() > 0.0f) {
+		core::recti Progress = Timeline;
+		Progress.LowerRightCorner.X = Timeline.UpperLeftCorner.X + (int)(Timeline.getWidth() * std::min(DisplayTime / Replay.GetFinishTime(), 1.0f));
+		irrDriver->draw2DRectangle(video::SColor(200, 255, 255, 255), Progress);
+	}
+
 	// Draw buttons
 	irrGUI->drawAll();
 }
@@ -539,9 +669,76 @@ void _ViewReplayState::Pause() {
 	}
 }
 
-// Skip ahead
+// Skip forward or backward
 void _ViewReplayState::Skip(float Amount) {
-	Framework.UpdateTimeStepAccumulator(Amount);
+	SeekTo(Timer + Amount);
+}
+
+// Jump to a time using the nearest keyframe before it
+void _ViewReplayState::SeekTo(float Time) {
+	if(Time < 0.0f)
+		Time = 0.0f;
+	if(Time > Replay.GetFinishTime())
+		Time = Replay.GetFinishTime();
+
+	// Play forward when no keyframe is closer than the current position
+	const _ReplayKeyframe *Keyframe = Replay.FindKeyframe(Time);
+	float StartTime = Timer;
+	if(Time < Timer || (Keyframe && Keyframe->Time > Timer)) {
+
+		// Restore the scene saved at the last keyframe, or rebuild it from the nearest keyframe or the start of the replay
+		if(LoadSeekSnapshot(Time, Keyframe ? Keyframe->Time : 0.0f))
+			StartTime = SeekSnapshotTime;
+		else {
+			ObjectManager.ClearObjects();
+			Player = nullptr;
+			if(Keyframe) {
+				Replay.SeekData(Keyframe->Offset);
+				Replay.ReadEvent(NextEvent);
+				ReadKeyframe(true);
+				StartTime = Keyframe->Time;
+			}
+			else {
+				Replay.SeekData(0);
+				StartTime = 0.0f;
+			}
+		}
+
+		Replay.ReadEvent(NextEvent);
+	}
+
+	// Apply events up to the new time
+	Timer = Time;
+	ProcessEvents();
+	ObjectManager.UpdateReplay(Time - StartTime);
+	ApplyPendingUpdates();
+
+	// Update number of lights
+	Graphics.SetLightCount();
+}
+
+// Get the screen area of the timeline
+core::recti _ViewReplayState::GetTimelineBounds() {
+	int Padding = 20 * Interface.GetUIScale();
+	int Height = 16 * Interface.GetUIScale();
+	core::dimension2du ScreenSize = irrDriver->getScreenSize();
+
+	return core::recti(Padding, ScreenSize.Height - Padding - Height, ScreenSize.Width - Padding, ScreenSize.Height - Padding);
+}
+
+// Convert a mouse position on the timeline to replay time
+float _ViewReplayState::GetTimelinePosition(float MouseX) {
+	core::recti Bounds = GetTimelineBounds();
+	if(Bounds.getWidth() <= 0)
+		return 0.0f;
+
+	float Percent = (MouseX - Bounds.UpperLeftCorner.X) / Bounds.getWidth();
+	if(Percent < 0.0f)
+		Percent = 0.0f;
+	else if(Percent > 1.0f)
+		Percent = 1.0f;
+
+	return Percent * Replay.GetFinishTime();
 }
 
 // Get how much time to adjust replay speed
@@ -20,7 +20,9 @@
 // Libraries
 #include <state.h>
 #include <replay.h>
+#include <physics.h>
 #include <vector3d.h>
+#include <rect.h>
 
 // Forward Declarations
 class _Object;
@@ -54,6 +56,7 @@ class _ViewReplayState : public _State {
 		bool HandleAction(int InputType, int Action, float Value);
 
 		void Update(float FrameTime);
+		void UpdateRender(float BlendFactor);
 		void Draw();
 
 		void SetCurrentReplay(const std::string &File) { CurrentReplay = File; }
@@ -64,13 +67,23 @@ class _ViewReplayState : public _State {
 		void ChangeReplaySpeed(float Amount);
 		void Pause();
 		void Skip(float Amount);
+		void SeekTo(float Time);
+		void ProcessEvents();
+		void ReadKeyframe(bool Apply);
+		void SaveSeekSnapshot(const irr::core::vector3df &CameraPosition, const irr::core::vector3df &CameraTarget);
+		bool LoadSeekSnapshot(float Time, float KeyframeTime);
+		void SetCamera(const irr::core::vector3df &Position, const irr::core::vector3df &LookAt);
+		void ApplyPendingUpdates();
 		float GetTimeIncrement();
+		irr::core::recti GetTimelineBounds();
+		float GetTimelinePosition(float MouseX);
 
 		// States
 		std::string CurrentReplay;
 		float Timer;
 		bool ShowHUD;
 		bool FreeCamera;
+		bool Scrubbing;
 
 		// Objects
 		_Camera *Camera;
@@ -83,6 +96,16 @@ class _ViewReplayState : public _State {
 		// Events
 		int NextPacketType;
 
+		// Last camera packet, applied once per rendered frame
+		irr::core::vector3df PendingCameraPosition, PendingCameraTarget;
+		bool CameraPending;
+
+		// Scene at the last keyframe read, restored when seeking back into its interval
+		_PhysicsSnapshot SeekSnapshot;
+		float SeekSnapshotTime;
+		uint32_t SeekSnapshotOffset;
+		irr::core::vector3df SeekCameraPosition, SeekCameraTarget;
+
 		// GUI
 		irr::gui::IGUIElement *Layout;
 };
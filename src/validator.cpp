@@ -0,0 +1,388 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <validator.h>
+#include <globals.h>
+#include <replay.h>
+#include <log.h>
+#include <IFileSystem.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <cctype>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <spawn.h>
+	#include <sys/wait.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <cerrno>
+	extern char **environ;
+#endif
+
+using namespace irr;
+
+// Finish times are printed with six decimals by the simulation
+const float VALIDATE_TIME_TOLERANCE = 0.001f;
+
+_Validator Validator;
+
+// Escapes a string for a json value
+static std::string EscapeJSON(const std::string &Value) {
+	std::string Escaped;
+	for(char Character : Value) {
+		if(Character == '"' || Character == '\\') {
+			Escaped += '\\';
+			Escaped += Character;
+		}
+		else if(Character == '\n')
+			Escaped += "\\n";
+		else if((unsigned char)Character < 0x20) {
+			char Code[8];
+			snprintf(Code, sizeof(Code), "\\u%04x", (unsigned char)Character);
+			Escaped += Code;
+		}
+		else
+			Escaped += Character;
+	}
+
+	return Escaped;
+}
+
+// Level names come from untrusted replay headers and are passed on to the child process
+static bool IsPlainIdentifier(const std::string &Value) {
+	if(Value.empty())
+		return false;
+
+	for(char Character : Value) {
+		if(!std::isalnum((unsigned char)Character) && Character != '_')
+			return false;
+	}
+
+	return true;
+}
+
+#ifdef _WIN32
+
+// Quotes an argument so the child's command line parser splits it back out unchanged
+static std::string QuoteArgument(const std::string &Argument) {
+	std::string Quoted = "\"";
+	size_t Backslashes = 0;
+	for(char Character : Argument) {
+		if(Character == '\\') {
+			Backslashes++;
+			continue;
+		}
+
+		// Backslashes are only special before a quote
+		if(Character == '"')
+			Quoted.append(Backslashes * 2 + 1, '\\');
+		else
+			Quoted.append(Backslashes, '\\');
+		Backslashes = 0;
+		Quoted += Character;
+	}
+	Quoted.append(Backslashes * 2, '\\');
+	Quoted += '"';
+
+	return Quoted;
+}
+
+#endif
+
+// Runs a program without a shell and collects its standard output, returns false if it couldn't be started
+static bool RunProcess(const std::vector<std::string> &Arguments, std::string &Output, int &Status) {
+	Output.clear();
+	Status = -1;
+
+	#ifdef _WIN32
+
+		// Build command line
+		std::string CommandLine;
+		for(const auto &Argument : Arguments) {
+			if(!CommandLine.empty())
+				CommandLine += ' ';
+			CommandLine += QuoteArgument(Argument);
+		}
+		std::vector<char> CommandLineBuffer(CommandLine.begin(), CommandLine.end());
+		CommandLineBuffer.push_back(0);
+
+		// Create pipe for stdout, only the write end is inherited
+		SECURITY_ATTRIBUTES Attributes = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+		HANDLE ReadPipe, WritePipe;
+		if(!CreatePipe(&ReadPipe, &WritePipe, &Attributes, 0))
+			return false;
+		SetHandleInformation(ReadPipe, HANDLE_FLAG_INHERIT, 0);
+
+		STARTUPINFOA StartupInfo = {};
+		StartupInfo.cb = sizeof(StartupInfo);
+		StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+		StartupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+		StartupInfo.hStdOutput = WritePipe;
+		StartupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+		// Start process
+		PROCESS_INFORMATION ProcessInfo;
+		BOOL Created = CreateProcessA(nullptr, CommandLineBuffer.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &StartupInfo, &ProcessInfo);
+		CloseHandle(WritePipe);
+		if(!Created) {
+			CloseHandle(ReadPipe);
+			return false;
+		}
+
+		// Read output until the child exits
+		char Buffer[4096];
+		DWORD BytesRead;
+		while(ReadFile(ReadPipe, Buffer, sizeof(Buffer), &BytesRead, nullptr) && BytesRead > 0)
+			Output.append(Buffer, BytesRead);
+		CloseHandle(ReadPipe);
+
+		DWORD ExitCode = 1;
+		WaitForSingleObject(ProcessInfo.hProcess, INFINITE);
+		GetExitCodeProcess(ProcessInfo.hProcess, &ExitCode);
+		CloseHandle(ProcessInfo.hProcess);
+		CloseHandle(ProcessInfo.hThread);
+		Status = (int)ExitCode;
+
+	#else
+
+		std::vector<char *> Argv;
+		for(const auto &Argument : Arguments)
+			Argv.push_back(const_cast<char *>(Argument.c_str()));
+		Argv.push_back(nullptr);
+
+		// Workers spawn in parallel, so keep pipes from leaking into each other's children
+		static std::mutex SpawnMutex;
+		pid_t Process;
+		int Pipe[2];
+		{
+			std::lock_guard<std::mutex> Lock(SpawnMutex);
+			if(pipe(Pipe) != 0)
+				return false;
+			fcntl(Pipe[0], F_SETFD, FD_CLOEXEC);
+			fcntl(Pipe[1], F_SETFD, FD_CLOEXEC);
+
+			// Send stdout to the pipe and discard stderr
+			posix_spawn_file_actions_t Actions;
+			posix_spawn_file_actions_init(&Actions);
+			posix_spawn_file_actions_adddup2(&Actions, Pipe[1], STDOUT_FILENO);
+			posix_spawn_file_actions_addopen(&Actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+			int Error = posix_spawnp(&Process, Argv[0], &Actions, nullptr, Argv.data(), environ);
+			posix_spawn_file_actions_destroy(&Actions);
+			close(Pipe[1]);
+			if(Error) {
+				close(Pipe[0]);
+				return false;
+			}
+		}
+
+		// Read output until the child exits
+		char Buffer[4096];
+		ssize_t BytesRead;
+		while((BytesRead = read(Pipe[0], Buffer, sizeof(Buffer))) != 0) {
+			if(BytesRead < 0) {
+				if(errno == EINTR)
+					continue;
+				break;
+			}
+			Output.append(Buffer, (size_t)BytesRead);
+		}
+		close(Pipe[0]);
+
+		int WaitStatus;
+		while(waitpid(Process, &WaitStatus, 0) < 0) {
+			if(errno != EINTR)
+				return true;
+		}
+		if(WIFEXITED(WaitStatus))
+			Status = WEXITSTATUS(WaitStatus);
+
+	#endif
+
+	return true;
+}
+
+// Validates every replay in a directory using a pool of worker processes, a process per replay keeps the simulation singletons apart
+int _Validator::Run(const std::string &Executable, const std::string &Path, int Jobs) {
+	this->Executable = Executable;
+	Results.clear();
+	NextResult = 0;
+
+	std::string Directory = Path;
+	if(Directory.size() && Directory.back() != '/' && Directory.back() != '\\')
+		Directory += '/';
+
+	// Get list of replays
+	std::vector<std::string> Filenames;
+	std::string OldWorkingDirectory(irrFile->getWorkingDirectory().c_str());
+	if(!irrFile->changeWorkingDirectoryTo(Directory.c_str())) {
+		Log.Write("_Validator::Run - Unable to open directory %s", Directory.c_str());
+		return 0;
+	}
+	io::IFileList *FileList = irrFile->createFileList();
+	for(uint32_t i = 0; i < FileList->getFileCount(); i++) {
+		std::string Filename = FileList->getFileName(i).c_str();
+		if(FileList->isDirectory(i) || Filename.size() < 7 || Filename.compare(Filename.size() - 7, 7, ".replay") != 0)
+			continue;
+
+		Filenames.push_back(Filename);
+	}
+	FileList->drop();
+	irrFile->changeWorkingDirectoryTo(OldWorkingDirectory.c_str());
+	std::sort(Filenames.begin(), Filenames.end());
+
+	// Read expected outcomes from replay headers
+	for(const auto &Filename : Filenames) {
+		_ValidateResult Result;
+		Result.Filename = Directory + Filename;
+		Result.Result = "error";
+		Result.ExpectedWon = false;
+		Result.Passed = false;
+		Result.FinishTime = 0.0f;
+		Result.ValidatedTime = 0.0f;
+		Result.Steps = 0;
+		Result.DesyncStep = -1;
+		Result.WallTime = 0.0;
+		Result.StepsPerSecond = 0.0;
+		if(Replay.LoadReplay(Result.Filename, true)) {
+			Result.LevelName = Replay.GetLevelName();
+			Result.ExpectedWon = Replay.GetWon();
+			Result.FinishTime = Replay.GetFinishTime();
+		}
+
+		Results.push_back(Result);
+	}
+
+	// Start workers
+	if(Jobs <= 0)
+		Jobs = std::max(1u, std::thread::hardware_concurrency());
+	Jobs = std::min(Jobs, std::max(1, (int)Results.size()));
+
+	auto StartTime = std::chrono::high_resolution_clock::now();
+	std::vector<std::thread> Workers;
+	for(int i = 0; i < Jobs; i++)
+		Workers.push_back(std::thread(&_Validator::RunWorker, this));
+	for(auto &Worker : Workers)
+		Worker.join();
+	std::chrono::duration<double> WallTime = std::chrono::high_resolution_clock::now() - StartTime;
+
+	// Write summary
+	int Passed = 0;
+	int64_t Steps = 0;
+	for(const auto &Result : Results) {
+		Passed += Result.Passed;
+		Steps += Result.Steps;
+	}
+	double StepsPerSecond = WallTime.count() > 0.0 ? Steps / WallTime.count() : 0.0;
+
+	std::ostringstream Buffer;
+	Buffer << std::fixed << std::setprecision(6);
+	Buffer << "{\"summary\": true"
+		<< ", \"total\": " << Results.size()
+		<< ", \"passed\": " << Passed
+		<< ", \"failed\": " << Results.size() - Passed
+		<< ", \"jobs\": " << Jobs
+		<< ", \"steps\": " << Steps
+		<< ", \"wall_time\": " << WallTime.count()
+		<< ", \"steps_per_second\": " << std::setprecision(0) << StepsPerSecond
+		<< "}";
+	std::cout << Buffer.str() << std::endl;
+
+	return Passed == (int)Results.size();
+}
+
+// Validates replays until none are left
+void _Validator::RunWorker() {
+
+	while(true) {
+		size_t Index = NextResult++;
+		if(Index >= Results.size())
+			break;
+
+		ValidateReplay(Results[Index]);
+		WriteResult(Results[Index]);
+	}
+}
+
+// Simulates a replay in a child process and compares the outcome to the header
+void _Validator::ValidateReplay(_ValidateResult &Result) {
+	if(!IsPlainIdentifier(Result.LevelName))
+		return;
+
+	// Run simulation
+	auto StartTime = std::chrono::high_resolution_clock::now();
+	std::string Output;
+	int Status;
+	if(!RunProcess({ Executable, "-simulate", Result.LevelName, "-replay", Result.Filename }, Output, Status))
+		return;
+
+	// Find simulation report
+	std::istringstream Stream(Output);
+	std::string Line;
+	bool Found = false;
+	while(std::getline(Stream, Line)) {
+		char Outcome[32];
+		float WallTime;
+		if(sscanf(Line.c_str(), "Simulation %31s after %d steps, game time=%fs wall time=%fs", Outcome, &Result.Steps, &Result.ValidatedTime, &WallTime) == 4) {
+			Result.Result = Outcome;
+			Found = true;
+		}
+		else if(Result.DesyncStep < 0)
+			sscanf(Line.c_str(), "Desync at step %d", &Result.DesyncStep);
+	}
+	std::chrono::duration<double> WallTime = std::chrono::high_resolution_clock::now() - StartTime;
+	Result.WallTime = WallTime.count();
+	Result.StepsPerSecond = Result.WallTime > 0.0 ? Result.Steps / Result.WallTime : 0.0;
+	if(!Found || Status != 0) {
+		Result.Result = "error";
+		return;
+	}
+
+	// Replays must stay in sync and reach the same outcome at the same time
+	bool Won = Result.Result == "won";
+	Result.Passed = Won == Result.ExpectedWon && std::fabs(Result.ValidatedTime - Result.FinishTime) <= VALIDATE_TIME_TOLERANCE && Result.DesyncStep < 0;
+}
+
+// Writes a json line for a replay
+void _Validator::WriteResult(const _ValidateResult &Result) {
+
+	std::ostringstream Buffer;
+	Buffer << std::fixed << std::setprecision(6);
+	Buffer << "{\"replay\": \"" << EscapeJSON(Result.Filename) << "\""
+		<< ", \"level\": \"" << EscapeJSON(Result.LevelName) << "\""
+		<< ", \"pass\": " << (Result.Passed ? "true" : "false")
+		<< ", \"result\": \"" << Result.Result << "\""
+		<< ", \"expected_won\": " << (Result.ExpectedWon ? "true" : "false")
+		<< ", \"finish_time\": " << Result.FinishTime
+		<< ", \"validated_time\": " << Result.ValidatedTime
+		<< ", \"finish_delta\": " << Result.ValidatedTime - Result.FinishTime
+		<< ", \"steps\": " << Result.Steps
+		<< ", \"desync_step\": " << Result.DesyncStep
+		<< ", \"wall_time\": " << Result.WallTime
+		<< ", \"steps_per_second\": " << std::setprecision(0) << Result.StepsPerSecond
+		<< "}";
+
+	std::lock_guard<std::mutex> Lock(OutputMutex);
+	std::cout << Buffer.str() << std::endl;
+}
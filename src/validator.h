@@ -0,0 +1,65 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+// Outcome of validating a single replay
+struct _ValidateResult {
+	std::string Filename;
+	std::string LevelName;
+	std::string Result;
+	bool ExpectedWon;
+	bool Passed;
+	float FinishTime;
+	float ValidatedTime;
+	int Steps;
+	int DesyncStep;
+	double WallTime;
+	double StepsPerSecond;
+};
+
+// Validates a directory of replays by simulating each one in its own process.
+// Physics, ObjectManager, Level and Scripting are still global singletons, so a
+// process per replay is what isolates the workers; running several simulations
+// inside one process would need those to become instances first.
+class _Validator {
+
+	public:
+
+		int Run(const std::string &Executable, const std::string &Path, int Jobs);
+
+	private:
+
+		void RunWorker();
+		void ValidateReplay(_ValidateResult &Result);
+		void WriteResult(const _ValidateResult &Result);
+
+		// Settings
+		std::string Executable;
+
+		// Results
+		std::vector<_ValidateResult> Results;
+		std::atomic<size_t> NextResult;
+		std::mutex OutputMutex;
+};
+
+// Singletons
+extern _Validator Validator;
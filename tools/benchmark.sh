@@ -0,0 +1,74 @@
+#!/bin/bash
+# Runs the bench_* levels headless and prints the median of the profiler sections each one measures.
+# Pass several binaries to compare builds, e.g. one built from the parent of the commit being measured.
+#
+# Usage: tools/benchmark.sh [irrlamb binary]...
+#   STEPS   physics steps per run (default 5000, the profile covers the last 1024)
+#   RUNS    runs per level and binary (default 3)
+#   LEVELS  levels to run (default all)
+# Load time is the wall time of a one step run, peak memory needs GNU time in /usr/bin/time or python3.
+
+steps=${STEPS:-5000}
+runs=${RUNS:-3}
+root=$(cd "$(dirname "$0")/.." && pwd)
+binaries=("$@")
+if [ ${#binaries[@]} -eq 0 ]; then
+	binaries=("$root/bin/Release/irrlamb")
+fi
+
+# Profiler sections reported for each level
+sections() {
+	case $1 in
+		bench_callbacks) echo "Callbacks Scripts" ;;
+		bench_objects) echo "Objects Scripts" ;;
+		bench_trimesh) echo "Collide Step" ;;
+		bench_terrain) echo "Collide Step" ;;
+	esac
+}
+
+levels=${LEVELS:-$(cd "$root/working/levels" && ls -d bench_* | tr '\n' ' ')}
+
+# Median of numbers on stdin
+median() {
+	sort -g | awk '{ v[NR] = $1 } END { if(NR) print v[int((NR + 1) / 2)] }'
+}
+
+cd "$root/working" || exit 1
+for level in $levels; do
+	for binary in "${binaries[@]}"; do
+		binary=$(cd "$(dirname "$binary")" && pwd)/$(basename "$binary")
+		line="$level $binary"
+
+		# Per step profile
+		output=""
+		for run in $(seq "$runs"); do
+			output+=$("$binary" -simulate "$level" -steps "$steps" 2>&1)$'\n'
+		done
+		for section in $(sections "$level") steps/sec; do
+			if [ "$section" = "steps/sec" ]; then
+				value=$(echo "$output" | grep -o "steps/sec=[0-9.]*" | cut -d= -f2 | median)
+			else
+				value=$(echo "$output" | awk -v s="$section" '$1 == s { print $2 }' | median)
+			fi
+			line+=" $section=$value"
+		done
+
+		# Load time
+		start=$(date +%s%N)
+		"$binary" -simulate "$level" -steps 1 > /dev/null 2>&1
+		end=$(date +%s%N)
+		line+=" load=$(( (end - start) / 1000000 ))ms"
+
+		# Peak memory
+		if [ -x /usr/bin/time ]; then
+			memory=$(/usr/bin/time -f "%M" "$binary" -simulate "$level" -steps 1 2>&1 > /dev/null | tail -1)KB
+		elif command -v python3 > /dev/null; then
+			memory=$(python3 -c 'import resource, subprocess, sys; subprocess.call(sys.argv[1:], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL); print(resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss)' "$binary" -simulate "$level" -steps 1)KB
+		else
+			memory="-"
+		fi
+		line+=" peak=$memory"
+
+		echo "$line"
+	done
+done
@@ -15,12 +15,17 @@
 *	You should have received a copy of the GNU General Public License
 *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **************************************************************************************/
+#include <colfile.h>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <fstream>
 #include <array>
 #include <map>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
 
 // Face struct
 struct _Face {
@@ -47,21 +52,42 @@ static std::vector<_Face> Faces;
 
 // Functions
 static bool ReadObjFile(const char *Filename);
-static bool WriteColFile(const char *Filename);
+static bool ReadColFile(const char *Filename);
+static bool WriteColFile(const char *Filename, bool WriteNormals, uint32_t IndexSize);
 
 int main(int ArgumentCount, char **Arguments) {
 
 	// Parse arguments
-	if(ArgumentCount != 2) {
-		std::cout << "Needs 1 argument: .obj file" << std::endl;
+	bool WriteNormals = false;
+	uint32_t IndexSize = COLFILE_INDEX_SIZE;
+	std::string File;
+	for(int i = 1; i < ArgumentCount; i++) {
+		if(strcmp(Arguments[i], "-normals") == 0)
+			WriteNormals = true;
+		else if(strcmp(Arguments[i], "-index16") == 0)
+			IndexSize = 2;
+		else if(File.empty())
+			File = Arguments[i];
+		else
+			File.clear();
+	}
+
+	if(File.empty()) {
+		std::cout << "Usage: colmesh [-normals] [-index16] file.obj|file.col" << std::endl;
+		std::cout << "  .obj files are converted to .col, version 1 .col files are upgraded in place" << std::endl;
+		std::cout << "  -index16 writes 16 bit indices for ODE builds with dTRIMESH_16BIT_INDICES" << std::endl;
 		return EXIT_FAILURE;
 	}
 
 	// Parse file
-	std::string File = Arguments[1];
+	bool Upgrade = false;
 	size_t Extension = File.rfind(".obj");
 	if(Extension == std::string::npos) {
-		std::cout << "Bad argument: " << Arguments[1] << std::endl;
+		Extension = File.rfind(".col");
+		Upgrade = true;
+	}
+	if(Extension == std::string::npos) {
+		std::cout << "Bad argument: " << File << std::endl;
 		return EXIT_FAILURE;
 	}
 
@@ -71,12 +97,12 @@ int main(int ArgumentCount, char **Arguments) {
 	std::string ColFilename = BaseName + std::string(".col");
 
 	// Read file
-	if(!ReadObjFile(ObjFilename.c_str())) {
+	if(!(Upgrade ? ReadColFile(ColFilename.c_str()) : ReadObjFile(ObjFilename.c_str()))) {
 		return EXIT_FAILURE;
 	}
 
 	// Write file
-	if(!WriteColFile(ColFilename.c_str())) {
+	if(!WriteColFile(ColFilename.c_str(), WriteNormals, IndexSize)) {
 		return EXIT_FAILURE;
 	}
 
@@ -152,8 +178,78 @@ bool ReadObjFile(const char *Filename) {
 	return true;
 }
 
-// Write vertices/faces to a binary file
-bool WriteColFile(const char *Filename) {
+// Read a version 1 col file
+bool ReadColFile(const char *Filename) {
+
+	// Open file
+	std::ifstream InputFile(Filename, std::ios::in | std::ios::binary);
+	if(!InputFile.is_open()) {
+		std::cout << "Error opening '" << Filename << "' for reading" << std::endl;
+
+		return false;
+	}
+
+	// Read header
+	int VertCount = 0;
+	int FaceCount = 0;
+	InputFile.read((char *)&VertCount, sizeof(int));
+	InputFile.read((char *)&FaceCount, sizeof(int));
+	if((uint32_t)VertCount == COLFILE_MAGIC) {
+		std::cout << "'" << Filename << "' is already version " << COLFILE_VERSION << std::endl;
+
+		return false;
+	}
+
+	// Read vertices and faces
+	Vertices.resize(VertCount < 0 ? 0 : (size_t)VertCount);
+	Faces.resize(FaceCount < 0 ? 0 : (size_t)FaceCount);
+	InputFile.read((char *)Vertices.data(), (std::streamsize)(Vertices.size() * sizeof(_Vertex)));
+	InputFile.read((char *)Faces.data(), (std::streamsize)(Faces.size() * sizeof(_Face)));
+	if(!InputFile || VertCount < 0 || FaceCount < 0) {
+		std::cout << "Error reading '" << Filename << "'" << std::endl;
+
+		return false;
+	}
+
+	// Check indices
+	for(auto &Face : Faces) {
+		for(int i = 0; i < 3; i++) {
+			if(Face[i] < 0 || Face[i] >= VertCount) {
+				std::cout << "Bad face index in '" << Filename << "'" << std::endl;
+
+				return false;
+			}
+		}
+	}
+
+	// Close file
+	InputFile.close();
+
+	return true;
+}
+
+// Pad file to the next block boundary
+static uint32_t AlignFile(std::ofstream &File) {
+	const char Padding[COLFILE_ALIGNMENT] = { 0 };
+	uint32_t Offset = (uint32_t)File.tellp();
+	uint32_t Remainder = Offset % COLFILE_ALIGNMENT;
+	if(Remainder) {
+		File.write(Padding, COLFILE_ALIGNMENT - Remainder);
+		Offset += COLFILE_ALIGNMENT - Remainder;
+	}
+
+	return Offset;
+}
+
+// Write vertices/faces to a version 2 binary file in ODE coordinates and winding
+bool WriteColFile(const char *Filename, bool WriteNormals, uint32_t IndexSize) {
+
+	// 16 bit indices have to fit every vertex
+	if(IndexSize == 2 && Vertices.size() > 0x10000) {
+		std::cout << "Too many vertices for 16 bit indices in '" << Filename << "'" << std::endl;
+
+		return false;
+	}
 
 	// Open file
 	std::ofstream File;
@@ -164,28 +260,72 @@ bool WriteColFile(const char *Filename) {
 		return false;
 	}
 
-	// Write header
-	int VertCount = Vertices.size();
-	int FaceCount = Faces.size();
-	File.write((char *)&VertCount, sizeof(int));
-	File.write((char *)&FaceCount, sizeof(int));
+	// Build header
+	_ColHeader Header;
+	memset(&Header, 0, sizeof(Header));
+	Header.Magic = COLFILE_MAGIC;
+	Header.Version = COLFILE_VERSION;
+	Header.VertexCount = (uint32_t)Vertices.size();
+	Header.FaceCount = (uint32_t)Faces.size();
+	Header.IndexSize = IndexSize;
+	Header.Flags = WriteNormals ? _ColHeader::FLAG_NORMALS : 0;
+
+	// Write header, offsets are filled in afterwards
+	File.write((char *)&Header, sizeof(Header));
 
 	// Write vertices
-	for(int i = 0; i < VertCount; i++) {
-		File.write((char *)&Vertices[i].Data[0], sizeof(float));
-		File.write((char *)&Vertices[i].Data[1], sizeof(float));
-		File.write((char *)&Vertices[i].Data[2], sizeof(float));
+	Header.VertexOffset = AlignFile(File);
+	std::vector<_Vertex> OdeVertices;
+	OdeVertices.reserve(Vertices.size());
+	for(auto &Vertex : Vertices)
+		OdeVertices.push_back(_Vertex(Vertex[0], Vertex[1], -Vertex[2]));
+	File.write((char *)OdeVertices.data(), (std::streamsize)(OdeVertices.size() * sizeof(_Vertex)));
+
+	// Write faces with reversed winding
+	Header.IndexOffset = AlignFile(File);
+	for(auto &Face : Faces) {
+		for(int i = 2; i >= 0; i--) {
+			if(Header.IndexSize == 2) {
+				uint16_t Index = (uint16_t)Face[i];
+				File.write((char *)&Index, sizeof(Index));
+			}
+			else {
+				uint32_t Index = (uint32_t)Face[i];
+				File.write((char *)&Index, sizeof(Index));
+			}
+		}
 	}
 
-	// Write faces
-	for(int i = 0; i < FaceCount; i++) {
-		File.write((char *)&Faces[i].Data[0], sizeof(int));
-		File.write((char *)&Faces[i].Data[1], sizeof(int));
-		File.write((char *)&Faces[i].Data[2], sizeof(int));
+	// Write face normals
+	if(WriteNormals) {
+		Header.NormalOffset = AlignFile(File);
+		for(auto &Face : Faces) {
+			const _Vertex &Vertex0 = OdeVertices[Face[2]];
+			const _Vertex &Vertex1 = OdeVertices[Face[1]];
+			const _Vertex &Vertex2 = OdeVertices[Face[0]];
+			float Edge1[3], Edge2[3], Normal[3];
+			for(int i = 0; i < 3; i++) {
+				Edge1[i] = Vertex1[i] - Vertex0[i];
+				Edge2[i] = Vertex2[i] - Vertex0[i];
+			}
+			Normal[0] = Edge1[1] * Edge2[2] - Edge1[2] * Edge2[1];
+			Normal[1] = Edge1[2] * Edge2[0] - Edge1[0] * Edge2[2];
+			Normal[2] = Edge1[0] * Edge2[1] - Edge1[1] * Edge2[0];
+			float Length = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+			if(Length > 0.0f) {
+				for(int i = 0; i < 3; i++)
+					Normal[i] /= Length;
+			}
+			File.write((char *)Normal, sizeof(Normal));
+		}
 	}
 
+	// Write final header
+	File.seekp(0);
+	File.write((char *)&Header, sizeof(Header));
+
 	// Close file
 	File.close();
 
-	return true;
+	return File.good();
 }
@@ -0,0 +1,412 @@
+/*************************************************************************************
+*	irrlamb - https://github.com/jazztickets/irrlamb
+*	Copyright (C) 2019  Alan Witkowski
+*
+*	This program is free software: you can redistribute it and/or modify
+*	it under the terms of the GNU General Public License as published by
+*	the Free Software Foundation, either version 3 of the License, or
+*	(at your option) any later version.
+*
+*	This program is distributed in the hope that it will be useful,
+*	but WITHOUT ANY WARRANTY; without even the implied warranty of
+*	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*	GNU General Public License for more details.
+*
+*	You should have received a copy of the GNU General Public License
+*	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************************/
+#include "replaytracks.h"
+#include <replay.h>
+#include <quaternion.h>
+#include <glm/trigonometric.hpp>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <tuple>
+
+// Samples for one track while exporting
+struct _TrackData {
+	_TrackEntry Entry;
+	_ReplayOrientation Base;
+	std::vector<float> Times;
+	std::vector<float> Columns[4];
+};
+
+// Globals
+static std::map<std::tuple<uint32_t, int32_t, uint32_t>, _TrackData> Tracks;
+static std::map<int32_t, uint32_t> Sequences;
+static std::vector<_TrackData *> LiveTracks;
+static std::string LevelName;
+static int32_t ReplayVersion = 0;
+static float FinishTime = 0.0f;
+
+// Functions
+static bool ReadReplayFile(const char *Filename);
+static bool WriteTracksFile(const char *Filename);
+static bool PrintTracks(const char *Filename);
+static bool PrintSamples(const char *Filename, const std::string &Name, float Start, float End);
+
+int main(int ArgumentCount, char **Arguments) {
+
+	// Parse arguments
+	std::string Command = ArgumentCount > 1 ? Arguments[1] : "";
+	if(Command == "export" && (ArgumentCount == 3 || ArgumentCount == 4)) {
+
+		// Get output filename
+		std::string File = Arguments[2];
+		std::string TracksFilename = ArgumentCount == 4 ? Arguments[3] : File.substr(0, File.rfind(".replay")) + ".tracks";
+
+		// Convert replay
+		if(!ReadReplayFile(File.c_str()) || !WriteTracksFile(TracksFilename.c_str()))
+			return EXIT_FAILURE;
+	}
+	else if(Command == "info" && ArgumentCount == 3) {
+		if(!PrintTracks(Arguments[2]))
+			return EXIT_FAILURE;
+	}
+	else if(Command == "query" && ArgumentCount >= 4 && ArgumentCount <= 6) {
+		float Start = ArgumentCount > 4 ? (float)atof(Arguments[4]) : 0.0f;
+		float End = ArgumentCount > 5 ? (float)atof(Arguments[5]) : 1e30f;
+		if(!PrintSamples(Arguments[2], Arguments[3], Start, End))
+			return EXIT_FAILURE;
+	}
+	else {
+		std::cout << "Usage:" << std::endl;
+		std::cout << "  replaytool export [.replay file] [.tracks file]" << std::endl;
+		std::cout << "  replaytool info [.tracks file]" << std::endl;
+		std::cout << "  replaytool query [.tracks file] [object id[:sequence]|camera|input|playerspeed] [start time] [end time]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// Get the track for an object's current create sequence or one of the player tracks
+static _TrackData &GetTrack(uint32_t Type, int32_t ObjectID=-1) {
+	uint32_t Sequence = Type == _ReplayTracks::TRACK_OBJECT ? Sequences[ObjectID] : 0;
+	auto Key = std::make_tuple(Type, ObjectID, Sequence);
+	auto Iterator = Tracks.find(Key);
+	if(Iterator != Tracks.end())
+		return Iterator->second;
+
+	_TrackData &Track = Tracks[Key];
+	Track.Entry.Type = Type;
+	Track.Entry.ObjectID = ObjectID;
+	Track.Entry.Sequence = Sequence;
+	Track.Entry.TemplateID = -1;
+	Track.Entry.CreateTime = 0.0f;
+	Track.Entry.DeleteTime = -1.0f;
+	Track.Entry.Count = 0;
+	Track.Entry.Offset = 0;
+
+	return Track;
+}
+
+// Add a sample with one array of values per column
+static void AddSample(_TrackData &Track, float Time, const float **Values) {
+	Track.Times.push_back(Time);
+	for(int i = 0; i < _ReplayTracks::GetColumnCount(Track.Entry.Type); i++)
+		Track.Columns[i].insert(Track.Columns[i].end(), Values[i], Values[i] + _ReplayTracks::GetColumnComponents(Track.Entry.Type, i));
+}
+
+// Add an object orientation
+static void AddObjectSample(_TrackData &Track, float Time, const glm::vec3 &Position, const glm::quat &Rotation) {
+	float Quaternion[4] = { Rotation.x, Rotation.y, Rotation.z, Rotation.w };
+	const float *Values[2] = { &Position[0], Quaternion };
+	AddSample(Track, Time, Values);
+}
+
+// Decode a replay into tracks
+bool ReadReplayFile(const char *Filename) {
+
+	// Open file
+	_ReplayReader Reader;
+	if(!Reader.Open(Filename)) {
+		std::cout << "Error opening '" << Filename << "' for reading" << std::endl;
+
+		return false;
+	}
+
+	// Read header chunks
+	size_t DataStart = 0;
+	uint32_t DataSize = 0;
+	while(!DataStart && Reader.GetRemaining()) {
+		uint8_t PacketType = Reader.Get<uint8_t>();
+		uint32_t PacketSize = Reader.Get<uint32_t>();
+		switch(PacketType) {
+			case _Replay::PACKET_REPLAYVERSION:
+				Reader.Get(ReplayVersion);
+			break;
+			case _Replay::PACKET_LEVELFILE: {
+				std::vector<char> Buffer(PacketSize);
+				Reader.GetData(Buffer.data(), PacketSize);
+				LevelName.assign(Buffer.begin(), Buffer.end());
+			} break;
+			case _Replay::PACKET_FINISHTIME:
+				Reader.Get(FinishTime);
+			break;
+			case _Replay::PACKET_OBJECTDATA:
+				DataStart = Reader.GetOffset();
+				DataSize = PacketSize;
+			break;
+			default:
+				Reader.Skip(PacketSize);
+			break;
+		}
+	}
+
+	// Check version
+	if(ReplayVersion < REPLAY_MINIMUM_VERSION || ReplayVersion > REPLAY_VERSION || !DataStart) {
+		std::cout << "Unsupported replay '" << Filename << "' version " << ReplayVersion << std::endl;
+
+		return false;
+	}
+
+	// Point reader at object data
+	if(ReplayVersion < 6)
+		Reader.SetRange(DataStart, Reader.GetMappingSize() - DataStart);
+	else if(!Reader.Inflate(DataStart, DataSize)) {
+		std::cout << "Corrupt replay data in '" << Filename << "'" << std::endl;
+
+		return false;
+	}
+
+	// Read events
+	bool Done = false;
+	while(!Done && Reader.GetRemaining() >= sizeof(uint8_t) + sizeof(float) && !Reader.IsOverrun()) {
+		uint8_t Type = Reader.Get<uint8_t>();
+		float Time = Reader.Get<float>();
+		switch(Type) {
+			case _Replay::PACKET_MOVEMENT: {
+				int16_t ObjectCount = Reader.Get<int16_t>();
+				size_t Cursor = 0;
+				for(int i = 0; i < ObjectCount; i++) {
+					glm::vec3 Position;
+					glm::quat Rotation;
+					if(ReplayVersion >= 6) {
+
+						// Objects are written in creation order, so a wrapped id matches the same object the game does
+						uint16_t ObjectID = Reader.Get<uint16_t>();
+						while(Cursor < LiveTracks.size() && LiveTracks[Cursor]->Entry.ObjectID != ObjectID)
+							Cursor++;
+
+						// Objects without a create event get a track on their first sample
+						_TrackData *Track;
+						if(Cursor < LiveTracks.size())
+							Track = LiveTracks[Cursor];
+						else {
+							Track = &GetTrack(_ReplayTracks::TRACK_OBJECT, ObjectID);
+							Cursor = 0;
+						}
+
+						Reader.GetMovement(Track->Base);
+						Track->Base.Get(Position, Rotation);
+						AddObjectSample(*Track, Time, Position, Rotation);
+					}
+					else {
+
+						// Older versions store node rotations as euler angles
+						const _ReplayMovementData *Data = Reader.View<_ReplayMovementData>();
+						irr::core::quaternion Quaternion(irr::core::vector3df(Data->Rotation[0], Data->Rotation[1], Data->Rotation[2]) * irr::core::DEGTORAD);
+						Position = glm::vec3(Data->Position[0], Data->Position[1], Data->Position[2]);
+						Rotation = glm::quat(Quaternion.W, Quaternion.X, Quaternion.Y, Quaternion.Z);
+						AddObjectSample(GetTrack(_ReplayTracks::TRACK_OBJECT, Data->ObjectID), Time, Position, Rotation);
+					}
+				}
+			} break;
+			case _Replay::PACKET_CREATE: {
+				const _ReplayCreateData *Data = Reader.View<_ReplayCreateData>();
+				float Orientation[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				float Rotation[3];
+				Reader.GetData(Orientation, sizeof(float) * (Data->PositionType == 1 ? 4 : 3));
+				Reader.GetData(Rotation, sizeof(float) * 3);
+
+				// Start a new object, a reused id gets a new track
+				uint16_t ObjectID = (uint16_t)Data->ObjectID;
+				if(Tracks.count(std::make_tuple((uint32_t)_ReplayTracks::TRACK_OBJECT, (int32_t)ObjectID, Sequences[ObjectID])))
+					Sequences[ObjectID]++;
+				_TrackData &Track = GetTrack(_ReplayTracks::TRACK_OBJECT, ObjectID);
+				Track.Entry.TemplateID = Data->TemplateID;
+				Track.Entry.CreateTime = Time;
+				LiveTracks.push_back(&Track);
+
+				// Planes have no position
+				if(Data->PositionType != 1)
+					AddObjectSample(Track, Time, glm::vec3(Orientation[0], Orientation[1], Orientation[2]), glm::quat(glm::radians(glm::vec3(Rotation[0], Rotation[1], Rotation[2]))));
+			} break;
+			case _Replay::PACKET_DELETE: {
+				const _ReplayDeleteData *Data = Reader.View<_ReplayDeleteData>();
+
+				// Deletes go to the oldest live object with the id
+				uint16_t ObjectID = (uint16_t)Data->ObjectID;
+				auto Iterator = std::find_if(LiveTracks.begin(), LiveTracks.end(), [ObjectID](const _TrackData *Track) { return Track->Entry.ObjectID == ObjectID; });
+				if(Iterator != LiveTracks.end()) {
+					(*Iterator)->Entry.DeleteTime = Time;
+					LiveTracks.erase(Iterator);
+				}
+				else
+					GetTrack(_ReplayTracks::TRACK_OBJECT, ObjectID).Entry.DeleteTime = Time;
+			} break;
+			case _Replay::PACKET_CAMERA: {
+				const _ReplayCameraData *Data = Reader.View<_ReplayCameraData>();
+				const float *Values[2] = { Data->Position, Data->Target };
+				AddSample(GetTrack(_ReplayTracks::TRACK_CAMERA), Time, Values);
+			} break;
+			case _Replay::PACKET_ORBDEACTIVATE:
+				Reader.Skip(sizeof(_ReplayOrbDeactivateData));
+			break;
+			case _Replay::PACKET_INPUT: {
+				const _ReplayInputData *Data = Reader.View<_ReplayInputData>();
+				float Push[2] = { Data->PushX, Data->PushZ };
+				float Jumped = Data->Jumped;
+				const float *Values[4] = { Push, &Data->Yaw, &Data->Pitch, &Jumped };
+				AddSample(GetTrack(_ReplayTracks::TRACK_INPUT), Time, Values);
+			} break;
+			case _Replay::PACKET_PLAYERSPEED: {
+				const _ReplayPlayerSpeedData *Data = Reader.View<_ReplayPlayerSpeedData>();
+				const float *Values[1] = { &Data->Speed };
+				AddSample(GetTrack(_ReplayTracks::TRACK_PLAYERSPEED), Time, Values);
+			} break;
+			case _Replay::PACKET_KEYFRAME: {
+				Reader.Skip(sizeof(_ReplayCameraData));
+				int16_t ObjectCount = Reader.Get<int16_t>();
+				Reader.Skip(ObjectCount * sizeof(_ReplayKeyframeObjectData));
+
+				// Movement after a keyframe isn't delta encoded against earlier samples
+				for(auto &Iterator : Tracks)
+					Iterator.second.Base.Reset();
+			} break;
+			case _Replay::PACKET_HASH: {
+				Reader.Skip(sizeof(uint32_t));
+				uint16_t ObjectCount = Reader.Get<uint16_t>();
+				Reader.Skip(ObjectCount * sizeof(_ReplayObjectHash));
+			} break;
+			default:
+				Done = true;
+			break;
+		}
+	}
+
+	return true;
+}
+
+// Write tracks as contiguous arrays
+bool WriteTracksFile(const char *Filename) {
+
+	// Open file
+	std::ofstream File;
+	File.open(Filename, std::ios::out | std::ios::binary);
+	if(!File.is_open()) {
+		std::cout << "Error opening '" << Filename << "' for writing" << std::endl;
+
+		return false;
+	}
+
+	// Write header
+	_TracksHeader Header;
+	std::memset(&Header, 0, sizeof(Header));
+	std::memcpy(Header.Magic, TRACKS_MAGIC, sizeof(TRACKS_MAGIC));
+	Header.Version = TRACKS_VERSION;
+	Header.ReplayVersion = ReplayVersion;
+	Header.FinishTime = FinishTime;
+	Header.TrackCount = (uint32_t)Tracks.size();
+	std::strncpy(Header.LevelName, LevelName.c_str(), sizeof(Header.LevelName) - 1);
+	File.write((char *)&Header, sizeof(Header));
+
+	// Write track table
+	uint64_t Offset = sizeof(_TracksHeader) + sizeof(_TrackEntry) * Tracks.size();
+	for(auto &Iterator : Tracks) {
+		_TrackData &Track = Iterator.second;
+		Track.Entry.Count = (uint32_t)Track.Times.size();
+		Track.Entry.Offset = Offset;
+		File.write((char *)&Track.Entry, sizeof(Track.Entry));
+
+		Offset += Track.Times.size() * sizeof(float);
+		for(int i = 0; i < _ReplayTracks::GetColumnCount(Track.Entry.Type); i++)
+			Offset += Track.Columns[i].size() * sizeof(float);
+	}
+
+	// Write times followed by each column
+	for(const auto &Iterator : Tracks) {
+		const _TrackData &Track = Iterator.second;
+		File.write((char *)Track.Times.data(), Track.Times.size() * sizeof(float));
+		for(int i = 0; i < _ReplayTracks::GetColumnCount(Track.Entry.Type); i++)
+			File.write((char *)Track.Columns[i].data(), Track.Columns[i].size() * sizeof(float));
+	}
+
+	// Close file
+	File.close();
+
+	return true;
+}
+
+// Print the track table of a tracks file
+bool PrintTracks(const char *Filename) {
+	_ReplayTracks ReplayTracks;
+	if(!ReplayTracks.Open(Filename)) {
+		std::cout << "Error opening '" << Filename << "' for reading" << std::endl;
+
+		return false;
+	}
+
+	const _TracksHeader *Header = ReplayTracks.GetHeader();
+	printf("level=%s replay_version=%d finish_time=%f tracks=%u\n", Header->LevelName, Header->ReplayVersion, Header->FinishTime, Header->TrackCount);
+	for(uint32_t i = 0; i < ReplayTracks.GetTrackCount(); i++) {
+		const _TrackEntry *Track = ReplayTracks.GetTrack(i);
+		printf("%s id=%d sequence=%u template=%d created=%f deleted=%f samples=%u\n", _ReplayTracks::GetTypeName(Track->Type), Track->ObjectID, Track->Sequence, Track->TemplateID, Track->CreateTime, Track->DeleteTime, Track->Count);
+	}
+
+	return true;
+}
+
+// Print the samples of a track in a time range
+bool PrintSamples(const char *Filename, const std::string &Name, float Start, float End) {
+	_ReplayTracks ReplayTracks;
+	if(!ReplayTracks.Open(Filename)) {
+		std::cout << "Error opening '" << Filename << "' for reading" << std::endl;
+
+		return false;
+	}
+
+	// Find track
+	const _TrackEntry *Track = nullptr;
+	for(uint32_t i = _ReplayTracks::TRACK_CAMERA; i < _ReplayTracks::TRACK_COUNT; i++) {
+		if(Name == _ReplayTracks::GetTypeName(i))
+			Track = ReplayTracks.FindTrack(i);
+	}
+
+	// Objects are queried by id with an optional create sequence
+	size_t Separator = Name.find(':');
+	std::string ObjectID = Name.substr(0, Separator);
+	std::string Sequence = Separator != std::string::npos ? Name.substr(Separator + 1) : "0";
+	if(!Track && !ObjectID.empty() && !Sequence.empty() && ObjectID.find_first_not_of("0123456789") == std::string::npos && Sequence.find_first_not_of("0123456789") == std::string::npos)
+		Track = ReplayTracks.FindTrack(_ReplayTracks::TRACK_OBJECT, atoi(ObjectID.c_str()), (uint32_t)atoi(Sequence.c_str()));
+	if(!Track) {
+		std::cout << "Track '" << Name << "' not found" << std::endl;
+
+		return false;
+	}
+
+	// Print samples in range
+	uint32_t First, Last;
+	ReplayTracks.GetRange(Track, Start, End, First, Last);
+	const float *Times = ReplayTracks.GetTimes(Track);
+	int ColumnCount = _ReplayTracks::GetColumnCount(Track->Type);
+	for(uint32_t i = First; i < Last; i++) {
+		printf("%f", Times[i]);
+		for(int j = 0; j < ColumnCount; j++) {
+			int Components = _ReplayTracks::GetColumnComponents(Track->Type, j);
+			const float *Values = ReplayTracks.GetColumn(Track, j) + i * Components;
+			for(int k = 0; k < Components; k++)
+				printf(" %f", Values[k]);
+		}
+		printf("\n");
+	}
+
+	return true;
+}
@@ -0,0 +1,140 @@
+/*************************************************************************************
+*	irrlamb - https://github.com/jazztickets/irrlamb
+*	Copyright (C) 2019  Alan Witkowski
+*
+*	This program is free software: you can redistribute it and/or modify
+*	it under the terms of the GNU General Public License as published by
+*	the Free Software Foundation, either version 3 of the License, or
+*	(at your option) any later version.
+*
+*	This program is distributed in the hope that it will be useful,
+*	but WITHOUT ANY WARRANTY; without even the implied warranty of
+*	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*	GNU General Public License for more details.
+*
+*	You should have received a copy of the GNU General Public License
+*	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************************/
+#include "replaytracks.h"
+#include <algorithm>
+
+// Number of floats per sample in each column
+static const int ColumnComponents[_ReplayTracks::TRACK_COUNT][4] = {
+	{ 3, 4, 0, 0 },
+	{ 3, 3, 0, 0 },
+	{ 2, 1, 1, 1 },
+	{ 1, 0, 0, 0 },
+};
+
+static const char *TypeNames[_ReplayTracks::TRACK_COUNT] = {
+	"object",
+	"camera",
+	"input",
+	"playerspeed",
+};
+
+// Get the number of columns in a track type
+int _ReplayTracks::GetColumnCount(uint32_t Type) {
+	if(Type >= TRACK_COUNT)
+		return 0;
+
+	int Count = 0;
+	while(Count < 4 && ColumnComponents[Type][Count])
+		Count++;
+
+	return Count;
+}
+
+// Get the number of floats per sample in a column
+int _ReplayTracks::GetColumnComponents(uint32_t Type, int Column) {
+	if(Type >= TRACK_COUNT || Column < 0 || Column >= 4)
+		return 0;
+
+	return ColumnComponents[Type][Column];
+}
+
+// Get the name of a track type
+const char *_ReplayTracks::GetTypeName(uint32_t Type) {
+	if(Type >= TRACK_COUNT)
+		return "unknown";
+
+	return TypeNames[Type];
+}
+
+// Map a tracks file and check its layout
+bool _ReplayTracks::Open(const std::string &Path) {
+	Header = nullptr;
+	Tracks = nullptr;
+	if(!Reader.Open(Path))
+		return false;
+
+	// Check header
+	const _TracksHeader *FileHeader = Reader.View<_TracksHeader>();
+	if(Reader.IsOverrun() || std::memcmp(FileHeader->Magic, TRACKS_MAGIC, sizeof(TRACKS_MAGIC)) != 0 || FileHeader->Version != TRACKS_VERSION) {
+		Close();
+		return false;
+	}
+
+	// Check track table
+	if(FileHeader->TrackCount > Reader.GetRemaining() / sizeof(_TrackEntry)) {
+		Close();
+		return false;
+	}
+	const _TrackEntry *FileTracks = reinterpret_cast<const _TrackEntry *>(Reader.GetMapping() + Reader.GetOffset());
+
+	// Check that every track's data is inside the file
+	for(uint32_t i = 0; i < FileHeader->TrackCount; i++) {
+		const _TrackEntry &Track = FileTracks[i];
+		uint64_t Size = (uint64_t)Track.Count * sizeof(float);
+		for(int j = 0; j < GetColumnCount(Track.Type); j++)
+			Size += (uint64_t)Track.Count * GetColumnComponents(Track.Type, j) * sizeof(float);
+
+		if(Track.Type >= TRACK_COUNT || Track.Offset % sizeof(float) || Track.Offset > Reader.GetMappingSize() || Size > Reader.GetMappingSize() - Track.Offset) {
+			Close();
+			return false;
+		}
+	}
+
+	Header = FileHeader;
+	Tracks = FileTracks;
+
+	return true;
+}
+
+// Unmap the file
+void _ReplayTracks::Close() {
+	Reader.Close();
+	Header = nullptr;
+	Tracks = nullptr;
+}
+
+// Find a track by type, objects also match on id and create sequence
+const _TrackEntry *_ReplayTracks::FindTrack(uint32_t Type, int32_t ObjectID, uint32_t Sequence) const {
+	for(uint32_t i = 0; i < GetTrackCount(); i++) {
+		if(Tracks[i].Type == Type && (Type != TRACK_OBJECT || (Tracks[i].ObjectID == ObjectID && Tracks[i].Sequence == Sequence)))
+			return &Tracks[i];
+	}
+
+	return nullptr;
+}
+
+// Get the sample times of a track
+const float *_ReplayTracks::GetTimes(const _TrackEntry *Track) const {
+	return reinterpret_cast<const float *>(Reader.GetMapping() + Track->Offset);
+}
+
+// Get the values of a column, stored after the times and the columns before it
+const float *_ReplayTracks::GetColumn(const _TrackEntry *Track, int Column) const {
+	const float *Values = GetTimes(Track) + Track->Count;
+	for(int i = 0; i < Column; i++)
+		Values += Track->Count * GetColumnComponents(Track->Type, i);
+
+	return Values;
+}
+
+// Binary search the sample times for a time range
+void _ReplayTracks::GetRange(const _TrackEntry *Track, float Start, float End, uint32_t &First, uint32_t &Last) const {
+	const float *Times = GetTimes(Track);
+	First = (uint32_t)(std::lower_bound(Times, Times + Track->Count, Start) - Times);
+	Last = (uint32_t)(std::lower_bound(Times + First, Times + Track->Count, End) - Times);
+}
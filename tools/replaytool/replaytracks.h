@@ -0,0 +1,114 @@
+/*************************************************************************************
+*	irrlamb - https://github.com/jazztickets/irrlamb
+*	Copyright (C) 2019  Alan Witkowski
+*
+*	This program is free software: you can redistribute it and/or modify
+*	it under the terms of the GNU General Public License as published by
+*	the Free Software Foundation, either version 3 of the License, or
+*	(at your option) any later version.
+*
+*	This program is distributed in the hope that it will be useful,
+*	but WITHOUT ANY WARRANTY; without even the implied warranty of
+*	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*	GNU General Public License for more details.
+*
+*	You should have received a copy of the GNU General Public License
+*	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************************/
+#pragma once
+
+// Libraries
+#include <replayreader.h>
+#include <string>
+#include <cstdint>
+
+// Constants
+const char TRACKS_MAGIC[4] = { 'I', 'R', 'T', 'K' };
+const uint32_t TRACKS_VERSION = 2;
+
+// File header, followed by the track table and then the column data
+#pragma pack(push, 1)
+struct _TracksHeader {
+	char Magic[4];
+	uint32_t Version;
+	int32_t ReplayVersion;
+	float FinishTime;
+	uint32_t TrackCount;
+	char LevelName[64];
+};
+
+// Track table entry, the track's data starts at Offset with the sample times followed by each column
+// Objects are keyed by id and create sequence, since ids are reused after they wrap
+struct _TrackEntry {
+	uint32_t Type;
+	int32_t ObjectID;
+	uint32_t Sequence;
+	int32_t TemplateID;
+	float CreateTime;
+	float DeleteTime;
+	uint32_t Count;
+	uint64_t Offset;
+};
+#pragma pack(pop)
+
+// Memory mapped columnar replay tracks
+class _ReplayTracks {
+
+	public:
+
+		enum TrackType {
+			TRACK_OBJECT,
+			TRACK_CAMERA,
+			TRACK_INPUT,
+			TRACK_PLAYERSPEED,
+			TRACK_COUNT,
+		};
+
+		// Columns of each track type, all stored as floats
+		enum ObjectColumnType {
+			OBJECT_POSITION,
+			OBJECT_ROTATION,
+		};
+
+		enum CameraColumnType {
+			CAMERA_POSITION,
+			CAMERA_TARGET,
+		};
+
+		enum InputColumnType {
+			INPUT_PUSH,
+			INPUT_YAW,
+			INPUT_PITCH,
+			INPUT_JUMPED,
+		};
+
+		enum PlayerSpeedColumnType {
+			PLAYERSPEED_SPEED,
+		};
+
+		static int GetColumnCount(uint32_t Type);
+		static int GetColumnComponents(uint32_t Type, int Column);
+		static const char *GetTypeName(uint32_t Type);
+
+		bool Open(const std::string &Path);
+		void Close();
+
+		const _TracksHeader *GetHeader() const { return Header; }
+		uint32_t GetTrackCount() const { return Header ? Header->TrackCount : 0; }
+		const _TrackEntry *GetTrack(uint32_t Index) const { return &Tracks[Index]; }
+		const _TrackEntry *FindTrack(uint32_t Type, int32_t ObjectID=-1, uint32_t Sequence=0) const;
+
+		// Arrays of Count samples, columns hold Count * GetColumnComponents values
+		const float *GetTimes(const _TrackEntry *Track) const;
+		const float *GetColumn(const _TrackEntry *Track, int Column) const;
+
+		// Get the samples [First, Last) with Start <= time < End
+		void GetRange(const _TrackEntry *Track, float Start, float End, uint32_t &First, uint32_t &Last) const;
+
+	private:
+
+		_ReplayReader Reader;
+		const _TracksHeader *Header;
+		const _TrackEntry *Tracks;
+
+};
@@ -0,0 +1,27 @@
+-- Benchmark for Lua handler dispatch, run with tools/benchmark.sh
+-- Every ball touches the plane each step, so each step calls OnHitBall once per ball, and 50 timers keep calling Tick
+
+-- Balls resting on the plane
+tBall = Level.GetTemplate("ball")
+for i = 0, 19 do
+	for j = 0, 19 do
+		Level.CreateObject("ball", tBall, i * 2 - 19, 0.5, j * 2 - 19)
+	end
+end
+
+-- Collision handler
+Hits = 0
+function OnHitBall(Ball, HitObject)
+	Hits = Hits + 1
+end
+
+-- Timers that each run every step
+Ticks = 0
+function Tick()
+	Ticks = Ticks + 1
+	Timer.Callback("Tick", 0.001)
+end
+
+for i = 1, 50 do
+	Timer.Callback("Tick", 0.001)
+end
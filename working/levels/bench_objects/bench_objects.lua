@@ -0,0 +1,32 @@
+-- Benchmark for object lookups with thousands of spawned objects, run with tools/benchmark.sh
+-- Every step looks up 200 objects by name and replaces 10 of them
+
+Count = 4000
+tPost = Level.GetTemplate("post")
+
+-- Spawn a 64 wide grid of named posts
+function CreatePost(Index)
+	Level.CreateObject("post" .. Index, tPost, (Index % 64) - 32, 0.25, math.floor(Index / 64) - 32)
+end
+
+for i = 0, Count - 1 do
+	CreatePost(i)
+end
+
+-- Look up and replace posts by name
+Random.Seed(1)
+function Tick()
+	for i = 1, 200 do
+		Object.GetPointer("post" .. Random.GetInt(0, Count - 1))
+	end
+
+	for i = 1, 10 do
+		local Index = Random.GetInt(0, Count - 1)
+		Object.Delete(Object.GetPointer("post" .. Index))
+		CreatePost(Index)
+	end
+
+	Timer.Callback("Tick", 0.001)
+end
+
+Timer.Callback("Tick", 0.001)
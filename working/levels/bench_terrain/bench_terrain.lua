@@ -0,0 +1,9 @@
+-- Benchmark for collision against the caves_3 heightmap terrain, run with tools/benchmark.sh
+-- Balls are dropped over the whole terrain and never sleep
+
+tBall = Level.GetTemplate("ball")
+for i = 0, 19 do
+	for j = 0, 19 do
+		Level.CreateObject("", tBall, i * 6 + 7, 40, j * 6 + 7)
+	end
+end
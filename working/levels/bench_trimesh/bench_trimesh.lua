@@ -0,0 +1,9 @@
+-- Benchmark for contacts against a trimesh, run with tools/benchmark.sh
+-- Bodies of three templates are dropped on the skate park collision mesh and never sleep
+
+Templates = { Level.GetTemplate("ball"), Level.GetTemplate("rubber"), Level.GetTemplate("crate") }
+for i = 0, 23 do
+	for j = 0, 15 do
+		Level.CreateObject("", Templates[(i + j) % 3 + 1], i * 2.5 - 28, 16, j * 3 - 22)
+	end
+end